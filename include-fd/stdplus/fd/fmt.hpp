@@ -24,7 +24,16 @@ namespace fd
 class FormatBuffer
 {
   public:
-    explicit FormatBuffer(Fd& fd, size_t max = 4096);
+    /** @brief Buffers formatted output for the file descriptor
+     *
+     *  @param[in] fd            - The file descriptor to write to
+     *  @param[in] max           - The amount of buffered output which
+     *                             triggers a write
+     *  @param[in] double_buffer - Writes without waiting for the file
+     *                             descriptor, see tryFlush()
+     */
+    explicit FormatBuffer(Fd& fd, size_t max = 4096,
+                          bool double_buffer = false);
     ~FormatBuffer() noexcept(false);
     FormatBuffer(const FormatBuffer&) = delete;
     FormatBuffer(FormatBuffer&&) = default;
@@ -54,12 +63,47 @@ class FormatBuffer
         writeIfNeeded();
     }
 
+    /** @brief Writes all buffered output, waiting for the file descriptor
+     *         if needed. A double buffered instance on a non-blocking file
+     *         descriptor throws exception::WouldBlock if the file
+     *         descriptor stops taking output, keeping the rest buffered.
+     */
     void flush();
 
+    /** @brief Writes as much buffered output as the file descriptor takes
+     *         without waiting. The output being written is set aside while
+     *         formatting continues into a second buffer, and both are
+     *         written together with writev.
+     *
+     *         Double buffered instances write with this once max is
+     *         reached. Once the file descriptor stops taking output they
+     *         stop writing on their own, so formatting overlaps with the
+     *         owner's event loop calling this whenever the file descriptor
+     *         becomes writable. If more than twice max gets buffered, the
+     *         append falls back to flush() as backpressure.
+     *
+     *  @return True if no output is left buffered
+     */
+    bool tryFlush();
+
+    /** @brief The amount of output not yet written */
+    inline size_t buffered() const noexcept
+    {
+        return pending.size() - pending_off + buf.size();
+    }
+
   private:
     std::reference_wrapper<Fd> fd;
     stdplus::StrBuf buf;
+    /** @brief Output set aside for writing, partially written up to the
+     *         offset
+     */
+    stdplus::StrBuf pending;
+    size_t pending_off = 0;
     size_t max;
+    bool double_buffer;
+    /** @brief The last write left output buffered */
+    bool blocked = false;
 
     void writeIfNeeded();
 };
@@ -28,6 +28,34 @@ class FdMock : public Fd
                 (std::span<const std::byte> data, SendFlags flags,
                  std::span<const std::byte> sockaddr),
                 (override));
+    MOCK_METHOD(std::span<std::byte>, pread,
+                (std::span<std::byte> buf, off_t offset), (override));
+    MOCK_METHOD(std::span<const std::byte>, pwrite,
+                (std::span<const std::byte> data, off_t offset), (override));
+    MOCK_METHOD(size_t, copyFileRange,
+                (std::optional<off_t> offset, Fd& out,
+                 std::optional<off_t> out_offset, size_t len),
+                (override));
+    MOCK_METHOD(size_t, splice,
+                (std::optional<off_t> offset, Fd& out,
+                 std::optional<off_t> out_offset, size_t len,
+                 SpliceFlags flags),
+                (override));
+    MOCK_METHOD(size_t, sendfile,
+                (Fd& out, std::optional<off_t> offset, size_t len),
+                (override));
+    MOCK_METHOD(size_t, recvmmsg,
+                (std::span<mmsghdr> msgs, RecvFlags flags), (override));
+    MOCK_METHOD(size_t, sendmmsg,
+                (std::span<mmsghdr> msgs, SendFlags flags), (override));
+    MOCK_METHOD(size_t, readv, (std::span<const iovec> iov), (override));
+    MOCK_METHOD(size_t, writev, (std::span<const iovec> iov), (override));
+    MOCK_METHOD(size_t, preadv2,
+                (std::span<const iovec> iov, off_t offset, RWFlags flags),
+                (override));
+    MOCK_METHOD(size_t, pwritev2,
+                (std::span<const iovec> iov, off_t offset, RWFlags flags),
+                (override));
     MOCK_METHOD(size_t, lseek, (off_t offset, Whence whence), (override));
     MOCK_METHOD(void, truncate, (off_t size), (override));
     MOCK_METHOD(void, bind, (std::span<const std::byte> sockaddr), (override));
@@ -23,6 +23,32 @@ class FdImpl : public Fd
     std::span<const std::byte> sendto(
         std::span<const std::byte> data, SendFlags flags,
         std::span<const std::byte> sockaddr) override;
+    IOResult<std::span<std::byte>> tryRead(std::span<std::byte> buf) override;
+    IOResult<std::span<std::byte>> tryRecv(std::span<std::byte> buf,
+                                           RecvFlags flags) override;
+    IOResult<std::span<const std::byte>> tryWrite(
+        std::span<const std::byte> data) override;
+    IOResult<std::span<const std::byte>> trySend(
+        std::span<const std::byte> data, SendFlags flags) override;
+    std::span<std::byte> pread(std::span<std::byte> buf,
+                               off_t offset) override;
+    std::span<const std::byte> pwrite(std::span<const std::byte> data,
+                                      off_t offset) override;
+    size_t copyFileRange(std::optional<off_t> offset, Fd& out,
+                         std::optional<off_t> out_offset,
+                         size_t len) override;
+    size_t splice(std::optional<off_t> offset, Fd& out,
+                  std::optional<off_t> out_offset, size_t len,
+                  SpliceFlags flags) override;
+    size_t sendfile(Fd& out, std::optional<off_t> offset, size_t len) override;
+    size_t recvmmsg(std::span<mmsghdr> msgs, RecvFlags flags) override;
+    size_t sendmmsg(std::span<mmsghdr> msgs, SendFlags flags) override;
+    size_t readv(std::span<const iovec> iov) override;
+    size_t writev(std::span<const iovec> iov) override;
+    size_t preadv2(std::span<const iovec> iov, off_t offset,
+                   RWFlags flags) override;
+    size_t pwritev2(std::span<const iovec> iov, off_t offset,
+                    RWFlags flags) override;
     size_t lseek(off_t offset, Whence whence) override;
     void truncate(off_t size) override;
     void bind(std::span<const std::byte> sockaddr) override;
@@ -2,10 +2,12 @@
 #include <fcntl.h>
 #include <sys/mman.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 
 #include <stdplus/flags.hpp>
 
 #include <cstddef>
+#include <expected>
 #include <optional>
 #include <span>
 #include <tuple>
@@ -23,6 +25,7 @@ enum class RecvFlag : int
     Peek = MSG_PEEK,
     Trunc = MSG_TRUNC,
     WaitAll = MSG_WAITALL,
+    WaitForOne = MSG_WAITFORONE,
 };
 using RecvFlags = BitFlags<RecvFlag>;
 
@@ -38,6 +41,25 @@ enum class SendFlag : int
 };
 using SendFlags = BitFlags<SendFlag>;
 
+enum class RWFlag : int
+{
+    Append = RWF_APPEND,
+    DSync = RWF_DSYNC,
+    HighPriority = RWF_HIPRI,
+    NoWait = RWF_NOWAIT,
+    Sync = RWF_SYNC,
+};
+using RWFlags = BitFlags<RWFlag>;
+
+enum class SpliceFlag : int
+{
+    Gift = SPLICE_F_GIFT,
+    More = SPLICE_F_MORE,
+    Move = SPLICE_F_MOVE,
+    NonBlock = SPLICE_F_NONBLOCK,
+};
+using SpliceFlags = BitFlags<SpliceFlag>;
+
 enum class Whence : int
 {
     Set = SEEK_SET,
@@ -111,6 +133,24 @@ class MMapFlags : public BitFlags<MMapFlag>
     constexpr MMapFlags(BitFlags<MMapFlag> flags) : BitFlags<MMapFlag>(flags) {}
 };
 
+/** @brief The failure reported by the non-throwing operations */
+struct IOError
+{
+    /** @brief The errno of the failure, 0 at the end of the stream */
+    int err;
+
+    constexpr bool eof() const noexcept
+    {
+        return err == 0;
+    }
+
+    /** @brief Throws the exception the throwing operations report with */
+    [[noreturn]] void raise(const char* name) const;
+};
+
+template <typename T>
+using IOResult = std::expected<T, IOError>;
+
 class MMap;
 
 class Fd
@@ -131,6 +171,45 @@ class Fd
     virtual std::span<const std::byte> sendto(
         std::span<const std::byte> data, SendFlags flags,
         std::span<const std::byte> sockaddr) = 0;
+
+    /** @brief Variants of the IO operations which return failures instead
+     *         of throwing. Would block is still an empty result. The
+     *         defaults wrap the throwing operations, implementations
+     *         override them to avoid exceptions entirely.
+     */
+    virtual IOResult<std::span<std::byte>> tryRead(std::span<std::byte> buf);
+    virtual IOResult<std::span<std::byte>> tryRecv(std::span<std::byte> buf,
+                                                   RecvFlags flags);
+    virtual IOResult<std::span<const std::byte>> tryWrite(
+        std::span<const std::byte> data);
+    virtual IOResult<std::span<const std::byte>> trySend(
+        std::span<const std::byte> data, SendFlags flags);
+
+    /** @brief Positional, batched, vectored and kernel side copying IO.
+     *         The vectored defaults transfer the first non-empty buffer
+     *         with the plain operations, the rest fail with ENOSYS unless
+     *         overridden.
+     */
+    virtual std::span<std::byte> pread(std::span<std::byte> buf,
+                                       off_t offset);
+    virtual std::span<const std::byte> pwrite(std::span<const std::byte> data,
+                                              off_t offset);
+    virtual size_t copyFileRange(std::optional<off_t> offset, Fd& out,
+                                 std::optional<off_t> out_offset,
+                                 size_t len);
+    virtual size_t splice(std::optional<off_t> offset, Fd& out,
+                          std::optional<off_t> out_offset, size_t len,
+                          SpliceFlags flags);
+    virtual size_t sendfile(Fd& out, std::optional<off_t> offset,
+                            size_t len);
+    virtual size_t recvmmsg(std::span<mmsghdr> msgs, RecvFlags flags);
+    virtual size_t sendmmsg(std::span<mmsghdr> msgs, SendFlags flags);
+    virtual size_t readv(std::span<const iovec> iov);
+    virtual size_t writev(std::span<const iovec> iov);
+    virtual size_t preadv2(std::span<const iovec> iov, off_t offset,
+                           RWFlags flags);
+    virtual size_t pwritev2(std::span<const iovec> iov, off_t offset,
+                            RWFlags flags);
     virtual size_t lseek(off_t offset, Whence whence) = 0;
     virtual void truncate(off_t size) = 0;
     virtual void bind(std::span<const std::byte> sockaddr) = 0;
@@ -3,8 +3,12 @@
 
 #include <array>
 #include <functional>
+#include <limits>
+#include <optional>
 #include <span>
 #include <string>
+#include <string_view>
+#include <vector>
 
 namespace stdplus
 {
@@ -14,22 +18,76 @@ namespace fd
 class LineReader
 {
   public:
+    /** @brief The default size of the read buffer */
     static constexpr size_t buf_size = 4096;
 
     LineReader(Fd& fd);
+
+    /** @brief Creates a reader of newline delimited lines
+     *
+     *  @param[in] fd   - The file descriptor to read from
+     *  @param[in] size - The size of the read buffer, which is the most
+     *                    read by one syscall. Only buffers larger than
+     *                    buf_size are allocated.
+     */
+    LineReader(Fd& fd, size_t size);
     LineReader(const LineReader&) = delete;
-    LineReader(LineReader&&) = default;
+    LineReader(LineReader&& other) noexcept;
     LineReader& operator=(const LineReader&) = delete;
-    LineReader& operator=(LineReader&&) = default;
+    LineReader& operator=(LineReader&& other) noexcept;
 
     const std::string* readLine();
 
+    /** @brief Like readLine() but the end of the stream and read failures
+     *         are returned instead of thrown
+     */
+    IOResult<const std::string*> tryReadLine();
+
+    /** @brief Like readLine() but avoids copying lines which are entirely
+     *         inside of the read buffer
+     *
+     *  @return The line, only valid until the reader is used again, or
+     *          std::nullopt if the read would block
+     */
+    std::optional<std::string_view> readLineView();
+
+    /** @brief Sets the sequence separating lines, like "\r\n" or a NUL
+     *
+     *  @param[in] delim - The delimiter, no longer than the read buffer
+     *  @throws std::system_error if the delimiter is empty or too long
+     */
+    void setDelimiter(std::string_view delim);
+
+    /** @brief Limits the length of lines
+     *         A longer line fails to read with EMSGSIZE and is skipped, the
+     *         following read returns the line after it.
+     *
+     *  @param[in] max - The maximum length in bytes, excluding the delimiter
+     */
+    inline void setMaxLine(size_t max) noexcept
+    {
+        max_line = max;
+    }
+
   private:
     std::reference_wrapper<Fd> fd;
-    std::array<char, buf_size> buf;
+    std::array<char, buf_size> inline_buf;
+    std::vector<char> heap_buf;
+    /** @brief The read buffer, in one of the above */
+    std::span<char> buf;
     std::span<char> buf_data;
     std::string line;
-    bool line_complete = false, hit_eof = false;
+    std::string delim = "\n";
+    size_t max_line = std::numeric_limits<size_t>::max();
+    bool line_complete = false, hit_eof = false, skip_line = false;
+
+    /** @brief Refills the buffer after any unconsumed data, false if the
+     *         read would block
+     */
+    IOResult<bool> fill();
+    std::optional<size_t> findDelim() const noexcept;
+    /** @brief Moves data before the delimiter into the line */
+    IOResult<void> append(size_t len);
 };
 
 } // namespace fd
@@ -0,0 +1,95 @@
+#pragma once
+#include <sys/socket.h>
+
+#include <stdplus/fd/intf.hpp>
+#include <stdplus/net/addr/sock.hpp>
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace stdplus
+{
+namespace fd
+{
+
+/** @brief Owns the headers, addresses and buffers for moving a batch of
+ *         datagrams with a single recvmmsg or sendmmsg call. The storage is
+ *         allocated once and reused by every batch.
+ */
+class MsgBatch
+{
+  public:
+    struct Msg
+    {
+        std::span<std::byte> data;
+        const SockAddrBuf& addr;
+        /** @brief The datagram was larger than the slot and was cut short */
+        bool truncated;
+    };
+
+    /** @brief Allocates the batch
+     *
+     *  @param[in] msgs     - The maximum number of messages per batch
+     *  @param[in] msg_size - The size of the buffer for each message
+     */
+    MsgBatch(size_t msgs, size_t msg_size);
+
+    inline size_t capacity() const noexcept
+    {
+        return hdrs.size();
+    }
+
+    /** @brief Receives as many datagrams as are available, up to capacity
+     *         Any queued messages are discarded.
+     *
+     *  @param[in] fd    - The socket to receive from
+     *  @param[in] flags - The flags passed to recvmmsg
+     *  @return The received messages, valid until the next use of the batch,
+     *          empty if the socket would block
+     */
+    std::span<const Msg> recv(Fd& fd, RecvFlags flags = {});
+
+    /** @brief Queues a copy of a datagram to be sent
+     *
+     *  @param[in] data - The datagram payload
+     *  @param[in] addr - The destination, omitted for connected sockets
+     *  @throws std::system_error if the payload is larger than a slot
+     *  @return False if the batch is already full
+     */
+    bool push(std::span<const std::byte> data);
+    bool push(std::span<const std::byte> data, const SockAddrBuf& addr);
+
+    /** @brief The number of messages queued and not yet sent */
+    inline size_t pending() const noexcept
+    {
+        return queued - head;
+    }
+
+    /** @brief Sends the queued messages with a single sendmmsg call
+     *         Messages the socket didn't accept stay queued.
+     *
+     *  @param[in] fd    - The socket to send to
+     *  @param[in] flags - The flags passed to sendmmsg
+     *  @return The number of messages sent, 0 if the socket would block
+     */
+    size_t send(Fd& fd, SendFlags flags = {});
+
+    /** @brief Drops all queued messages */
+    void clear() noexcept;
+
+  private:
+    size_t msg_size;
+    std::vector<std::byte> bufs;
+    std::vector<SockAddrBuf> addrs;
+    std::vector<iovec> iovs;
+    std::vector<mmsghdr> hdrs;
+    std::vector<Msg> msgs;
+    size_t head = 0;
+    size_t queued = 0;
+
+    std::span<std::byte> slot(size_t i) noexcept;
+};
+
+} // namespace fd
+} // namespace stdplus
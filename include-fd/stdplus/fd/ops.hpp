@@ -5,7 +5,10 @@
 #include <stdplus/net/addr/sock.hpp>
 #include <stdplus/raw.hpp>
 
+#include <algorithm>
+#include <optional>
 #include <span>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
@@ -22,10 +25,19 @@ void writeExact(Fd& fd, std::span<const std::byte> data);
 void sendExact(Fd& fd, std::span<const std::byte> data, SendFlags flags);
 void sendtoExact(Fd& fd, std::span<const std::byte> data, SendFlags flags,
                  std::span<const std::byte> addr);
+void preadExact(Fd& fd, std::span<std::byte> data, off_t offset);
+void pwriteExact(Fd& fd, std::span<const std::byte> data, off_t offset);
+void copyFileRangeExact(Fd& in, std::optional<off_t> offset, Fd& out,
+                        std::optional<off_t> out_offset, size_t len);
+void spliceExact(Fd& in, std::optional<off_t> offset, Fd& out,
+                 std::optional<off_t> out_offset, size_t len,
+                 SpliceFlags flags);
+void sendfileExact(Fd& in, Fd& out, std::optional<off_t> offset, size_t len);
 
 std::span<std::byte> readAligned(Fd& fd, size_t align,
                                  std::span<std::byte> buf);
-void readAll(Fd& fd, function_view<std::span<std::byte>(size_t req)> resize);
+void readAll(Fd& fd, function_view<std::span<std::byte>(size_t req)> resize,
+             size_t initB);
 std::span<std::byte> readAllFixed(Fd& fd, size_t align,
                                   std::span<std::byte> buf);
 std::span<std::byte> recvAligned(Fd& fd, size_t align, std::span<std::byte> buf,
@@ -34,6 +46,14 @@ std::span<const std::byte> writeAligned(Fd& fd, size_t align,
                                         std::span<const std::byte> data);
 std::span<const std::byte> sendAligned(
     Fd& fd, size_t align, std::span<const std::byte> data, SendFlags flags);
+IOResult<std::span<std::byte>> tryReadAligned(Fd& fd, size_t align,
+                                              std::span<std::byte> buf);
+IOResult<std::span<std::byte>> tryRecvAligned(
+    Fd& fd, size_t align, std::span<std::byte> buf, RecvFlags flags);
+IOResult<std::span<const std::byte>> tryWriteAligned(
+    Fd& fd, size_t align, std::span<const std::byte> data);
+IOResult<std::span<const std::byte>> trySendAligned(
+    Fd& fd, size_t align, std::span<const std::byte> data, SendFlags flags);
 
 void verifyExact(size_t expected, size_t actual);
 
@@ -55,17 +75,55 @@ inline auto read(Fd& fd, Container&& c)
                              std::forward<Container>(c));
 }
 
-template <typename Container = std::vector<std::byte>>
-Container readAll(Fd& fd)
+/** @brief Reads until the end of the file into the container, replacing
+ *         its contents. The memory of the container is reused, so reading
+ *         many files into the same container rarely allocates. Strings
+ *         grow without initializing the new characters, other containers
+ *         value initialize newly grown elements.
+ *
+ *  @param[in] fd   - The file descriptor to read from
+ *  @param[in] c    - The container to fill
+ *  @param[in] hint - The expected size in bytes, like st_size from fstat.
+ *                    An accurate hint finishes in one read plus the read
+ *                    that observes the end of the file.
+ */
+template <typename Container>
+    requires(!std::is_integral_v<std::remove_cvref_t<Container>>)
+void readAll(Fd& fd, Container& c, size_t hint = 0)
 {
     using Data = raw::detail::dataType<Container>;
-    Container ret;
     auto resize = [&](size_t req) {
-        ret.resize((req + sizeof(Data) - 1) / sizeof(Data));
-        return std::span(reinterpret_cast<std::byte*>(ret.data()),
-                         ret.size() * sizeof(Data));
+        auto n = (req + sizeof(Data) - 1) / sizeof(Data);
+        // The data is overwritten by the reads before it is ever used
+        if constexpr (requires {
+                          c.resize_and_overwrite(
+                              n, [](Data*, size_t m) { return m; });
+                      })
+        {
+            c.resize_and_overwrite(n, [](Data*, size_t m) { return m; });
+        }
+        else
+        {
+            c.resize(n);
+        }
+        return std::span(reinterpret_cast<std::byte*>(c.data()),
+                         c.size() * sizeof(Data));
     };
-    detail::readAll(fd, resize);
+    // Asking for a byte past the hint lets the end of the file be found
+    // without growing, small hints still read in reasonably sized strides
+    size_t capacityB = 0;
+    if constexpr (requires { c.capacity(); })
+    {
+        capacityB = c.capacity() * sizeof(Data);
+    }
+    detail::readAll(fd, resize, std::max({hint + 1, capacityB, size_t{256}}));
+}
+
+template <typename Container = std::vector<std::byte>>
+Container readAll(Fd& fd, size_t hint = 0)
+{
+    Container ret;
+    readAll(fd, ret, hint);
     return ret;
 }
 
@@ -95,6 +153,57 @@ auto recvfrom(Fd& fd, Container&& c, SockAddrBuf& addr, RecvFlags flags = {})
                            std::get<0>(ret).size() / sizeof(Data));
 }
 
+namespace detail
+{
+
+template <typename Fun, typename Container, typename... Args>
+auto tryAlignedOp(Fun&& fun, Fd& fd, Container&& c, Args&&... args)
+    -> IOResult<std::span<raw::detail::dataType<Container>>>
+{
+    using Data = raw::detail::dataType<Container>;
+    auto ret = fun(fd, sizeof(Data), raw::asSpan<std::byte>(c),
+                   std::forward<Args>(args)...);
+    if (!ret)
+    {
+        return std::unexpected(ret.error());
+    }
+    return std::span<Data>(std::begin(c), ret->size() / sizeof(Data));
+}
+
+} // namespace detail
+
+/** @brief Non-throwing IO, failures and the end of the stream are returned
+ *         as an IOError. Like read() partial elements are completed, if
+ *         that fails the error is EILSEQ like exception::Incomplete.
+ */
+template <typename Container>
+inline auto tryRead(Fd& fd, Container&& c)
+{
+    return detail::tryAlignedOp(detail::tryReadAligned, fd,
+                                std::forward<Container>(c));
+}
+
+template <typename Container>
+inline auto tryRecv(Fd& fd, Container&& c, RecvFlags flags = {})
+{
+    return detail::tryAlignedOp(detail::tryRecvAligned, fd,
+                                std::forward<Container>(c), flags);
+}
+
+template <typename Container>
+inline auto tryWrite(Fd& fd, Container&& c)
+{
+    return detail::tryAlignedOp(detail::tryWriteAligned, fd,
+                                std::forward<Container>(c));
+}
+
+template <typename Container>
+inline auto trySend(Fd& fd, Container&& c, SendFlags flags = {})
+{
+    return detail::tryAlignedOp(detail::trySendAligned, fd,
+                                std::forward<Container>(c), flags);
+}
+
 template <typename Container>
 inline auto write(Fd& fd, Container&& c)
 {
@@ -160,6 +269,136 @@ inline void sendtoExact(Fd& fd, Container&& c, const SockAddrBuf& addr,
         std::span(reinterpret_cast<const std::byte*>(&addr), addr.len));
 }
 
+template <typename Container>
+auto pread(Fd& fd, Container&& c, off_t offset)
+{
+    using Data = raw::detail::dataType<Container>;
+    auto ret = fd.pread(raw::asSpan<std::byte>(c), offset);
+    return std::span<Data>(std::begin(c), ret.size() / sizeof(Data));
+}
+
+template <typename Container>
+auto pwrite(Fd& fd, Container&& c, off_t offset)
+{
+    using Data = raw::detail::dataType<Container>;
+    auto ret = fd.pwrite(raw::asSpan<std::byte>(c), offset);
+    return std::span<Data>(std::begin(c), ret.size() / sizeof(Data));
+}
+
+template <typename T>
+inline void preadExact(Fd& fd, T&& t, off_t offset)
+{
+    detail::preadExact(fd, raw::asSpan<std::byte>(t), offset);
+}
+
+template <typename T>
+inline void pwriteExact(Fd& fd, T&& t, off_t offset)
+{
+    detail::pwriteExact(fd, raw::asSpan<std::byte>(t), offset);
+}
+
+/** @brief Copies data between files without passing through userspace
+ *
+ *  @param[in] in         - The file to copy from
+ *  @param[in] offset     - The offset in the input, or its file position
+ *  @param[in] out        - The file to copy to
+ *  @param[in] out_offset - The offset in the output, or its file position
+ *  @param[in] len        - The number of bytes to copy
+ *  @return The number of bytes copied, 0 if the copy would block
+ */
+inline size_t copyFileRange(Fd& in, std::optional<off_t> offset, Fd& out,
+                            std::optional<off_t> out_offset, size_t len)
+{
+    return in.copyFileRange(offset, out, out_offset, len);
+}
+
+inline size_t splice(Fd& in, std::optional<off_t> offset, Fd& out,
+                     std::optional<off_t> out_offset, size_t len,
+                     SpliceFlags flags = {})
+{
+    return in.splice(offset, out, out_offset, len, flags);
+}
+
+inline size_t sendfile(Fd& in, Fd& out, std::optional<off_t> offset,
+                       size_t len)
+{
+    return in.sendfile(out, offset, len);
+}
+
+/** @brief Copies exactly len bytes with as many copy_file_range calls as
+ *         needed. Offsets which are given advance with the copy.
+ *
+ *  @throws exception::Incomplete if only part of the data was copied
+ */
+inline void copyFileRangeExact(Fd& in, std::optional<off_t> offset, Fd& out,
+                               std::optional<off_t> out_offset, size_t len)
+{
+    detail::copyFileRangeExact(in, offset, out, out_offset, len);
+}
+
+inline void spliceExact(Fd& in, std::optional<off_t> offset, Fd& out,
+                        std::optional<off_t> out_offset, size_t len,
+                        SpliceFlags flags = {})
+{
+    detail::spliceExact(in, offset, out, out_offset, len, flags);
+}
+
+inline void sendfileExact(Fd& in, Fd& out, std::optional<off_t> offset,
+                          size_t len)
+{
+    detail::sendfileExact(in, out, offset, len);
+}
+
+inline size_t recvmmsg(Fd& fd, std::span<mmsghdr> msgs, RecvFlags flags = {})
+{
+    return fd.recvmmsg(msgs, flags);
+}
+
+inline size_t sendmmsg(Fd& fd, std::span<mmsghdr> msgs, SendFlags flags = {})
+{
+    return fd.sendmmsg(msgs, flags);
+}
+
+inline size_t readv(Fd& fd, std::span<const iovec> iov)
+{
+    return fd.readv(iov);
+}
+
+inline size_t writev(Fd& fd, std::span<const iovec> iov)
+{
+    return fd.writev(iov);
+}
+
+inline size_t preadv2(Fd& fd, std::span<const iovec> iov, off_t offset,
+                      RWFlags flags = {})
+{
+    return fd.preadv2(iov, offset, flags);
+}
+
+inline size_t pwritev2(Fd& fd, std::span<const iovec> iov, off_t offset,
+                       RWFlags flags = {})
+{
+    return fd.pwritev2(iov, offset, flags);
+}
+
+/** @brief Fills all of the buffers in order, continuing partial reads
+ *         from where they stopped, even in the middle of a buffer.
+ *
+ *  @param[in] fd   - The file descriptor to read from
+ *  @param[in] bufs - The buffers to fill
+ *  @throws exception::Incomplete if only part of the data was read
+ */
+void readvExact(Fd& fd, std::span<const std::span<std::byte>> bufs);
+
+/** @brief Writes all of the buffers in order with vectored writes,
+ *         continuing partial writes from where they stopped.
+ *
+ *  @param[in] fd   - The file descriptor to write to
+ *  @param[in] bufs - The data to write
+ *  @throws exception::Incomplete if only part of the data was written
+ */
+void writevExact(Fd& fd, std::span<const std::span<const std::byte>> bufs);
+
 inline size_t lseek(Fd& fd, off_t offset, Whence whence)
 {
     return fd.lseek(offset, whence);
@@ -0,0 +1,132 @@
+#pragma once
+#include <stdplus/fd/intf.hpp>
+#include <stdplus/fd/mmap.hpp>
+#include <stdplus/function_view.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace stdplus
+{
+namespace fd
+{
+
+/** @brief Reads the delimited records of a regular file through a memory
+ *         mapping, returning them without any copies
+ *  @details Records are split like LineReader does, including the final
+ *           record after the last delimiter which may be empty. Huge files
+ *           are mapped a window at a time, the window grows to fit any
+ *           record larger than it.
+ */
+class MMapRecords
+{
+  public:
+    /** @brief The default size of the mapped window */
+    static constexpr size_t window_size = size_t{64} << 20;
+
+    /** @brief Prepares to read records from the file
+     *
+     *  @param[in] fd     - The regular file to map
+     *  @param[in] window - The amount of the file mapped at a time
+     *  @param[in] delim  - The sequence separating records
+     *  @throws std::system_error if the file size can't be determined or
+     *          the delimiter is empty
+     */
+    explicit MMapRecords(Fd& fd, size_t window = window_size,
+                         std::string_view delim = "\n");
+
+    /** @brief Gets the next record
+     *
+     *  @return The record, only valid until the next call, or
+     *          std::nullopt once all records were returned
+     */
+    std::optional<std::string_view> next();
+
+    class iterator
+    {
+      public:
+        using value_type = std::string_view;
+        using difference_type = std::ptrdiff_t;
+
+        iterator() = default;
+
+        inline std::string_view operator*() const noexcept
+        {
+            return *cur;
+        }
+        inline iterator& operator++()
+        {
+            cur = records->next();
+            return *this;
+        }
+        inline void operator++(int)
+        {
+            ++*this;
+        }
+        inline bool operator==(std::default_sentinel_t) const noexcept
+        {
+            return !cur;
+        }
+
+      private:
+        MMapRecords* records = nullptr;
+        std::optional<std::string_view> cur;
+
+        inline explicit iterator(MMapRecords& records) :
+            records(&records), cur(records.next())
+        {}
+        friend class MMapRecords;
+    };
+
+    /** @brief Iterates over the remaining records, a single pass */
+    inline iterator begin()
+    {
+        return iterator(*this);
+    }
+    inline std::default_sentinel_t end() const noexcept
+    {
+        return {};
+    }
+
+  private:
+    std::reference_wrapper<Fd> fd;
+    size_t window;
+    std::string delim;
+    size_t size;
+    size_t pos = 0;
+    bool done = false;
+    std::optional<MMap> map;
+    size_t map_off = 0;
+
+    void remap(size_t len);
+};
+
+/** @brief Calls the function for every record of a regular file from a set
+ *         of threads
+ *  @details The file is mapped and split into chunks of about chunk_size
+ *           bytes, each ending in a delimiter. Threads take whole chunks, so
+ *           records of a chunk are processed in order, but chunks run
+ *           concurrently. Records split like MMapRecords for delimiters
+ *           which can't overlap themselves, like "\n" or "\r\n".
+ *
+ *  @param[in] fd         - The regular file to read
+ *  @param[in] fn         - Called with the index of the chunk and each
+ *                          record, concurrently from multiple threads
+ *  @param[in] threads    - The number of threads, 0 for one per CPU
+ *  @param[in] delim      - The sequence separating records
+ *  @param[in] chunk_size - The approximate size of chunks
+ *  @throws The first exception thrown by fn, the remaining chunks are
+ *          skipped
+ *  @return The number of chunks
+ */
+size_t parallelRecords(
+    Fd& fd, function_view<void(size_t chunk, std::string_view record)> fn,
+    size_t threads = 0, std::string_view delim = "\n",
+    size_t chunk_size = size_t{4} << 20);
+
+} // namespace fd
+} // namespace stdplus
@@ -1,12 +1,33 @@
 #pragma once
 
 #include <liburing.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
 
+#include <stdplus/fd/create.hpp>
+#include <stdplus/fd/dupable.hpp>
+#include <stdplus/fd/intf.hpp>
 #include <stdplus/fd/managed.hpp>
+#include <stdplus/flags.hpp>
+#include <stdplus/function_view.hpp>
 #include <stdplus/handle/managed.hpp>
+#include <stdplus/net/addr/sock.hpp>
+#include <stdplus/raw.hpp>
+#include <stdplus/zstring.hpp>
 
+#include <array>
 #include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <exception>
+#include <memory>
 #include <optional>
+#include <span>
+#include <system_error>
+#include <utility>
 #include <vector>
 
 namespace stdplus
@@ -18,6 +39,71 @@ __kernel_timespec chronoToKTS(std::chrono::nanoseconds t) noexcept;
 class IoUring
 {
   public:
+    enum class SetupFlag : unsigned
+    {
+        IOPoll = IORING_SETUP_IOPOLL,
+        SQPoll = IORING_SETUP_SQPOLL,
+        SQAff = IORING_SETUP_SQ_AFF,
+        Clamp = IORING_SETUP_CLAMP,
+        SubmitAll = IORING_SETUP_SUBMIT_ALL,
+        CoopTaskrun = IORING_SETUP_COOP_TASKRUN,
+        TaskrunFlag = IORING_SETUP_TASKRUN_FLAG,
+        SingleIssuer = IORING_SETUP_SINGLE_ISSUER,
+        DeferTaskrun = IORING_SETUP_DEFER_TASKRUN,
+    };
+    using SetupFlags = BitFlags<SetupFlag>;
+
+    /** @brief What getSQE() does when the submission queue is full */
+    enum class SQFull
+    {
+        /** @brief Throw std::system_error */
+        Throw,
+        /** @brief Submit the queued SQEs to make room */
+        Submit,
+        /** @brief Submit the queued SQEs and process available CQEs so the
+         *         completion queue can't overflow. Within process() the
+         *         queue is only submitted. */
+        SubmitProcess,
+    };
+
+    /** @brief Typed builder for the ring parameters
+     *  @details Presets cover the common latency modes:
+     *           - sqPoll(): A kernel thread polls the SQ so submit() only
+     *             needs a syscall to wake it once it goes idle.
+     *           - coopTaskrun(): Completions are only run when the ring
+     *             enters the kernel instead of interrupting the task.
+     *           - deferTaskrun(): Completions are deferred until
+     *             process() or wait() asks for them. The ring must only be
+     *             used from the thread which created it.
+     */
+    class Setup
+    {
+      public:
+        explicit Setup(size_t queue_size = 10) noexcept;
+
+        Setup& set(SetupFlag flag) noexcept;
+        Setup& set(SetupFlags flags) noexcept;
+        Setup& cqSize(unsigned entries) noexcept;
+        Setup& sqPoll(std::chrono::milliseconds idle,
+                      std::optional<unsigned> cpu = std::nullopt) noexcept;
+        Setup& coopTaskrun() noexcept;
+        Setup& deferTaskrun() noexcept;
+
+        inline size_t getQueueSize() const noexcept
+        {
+            return queue_size;
+        }
+
+        inline const io_uring_params& getParams() const noexcept
+        {
+            return params;
+        }
+
+      private:
+        size_t queue_size;
+        io_uring_params params = {};
+    };
+
     struct CQEHandler
     {
         CQEHandler() = default;
@@ -27,7 +113,324 @@ class IoUring
         CQEHandler& operator=(const CQEHandler&) = delete;
         virtual ~CQEHandler() = default;
 
+        /** @brief Called for every CQE of the associated requests.
+         *         Multishot requests call this repeatedly while
+         *         IORING_CQE_F_MORE is set in the CQE flags.
+         */
         virtual void handleCQE(io_uring_cqe&) noexcept = 0;
+
+      private:
+        /** @brief Index of this handler in the ring's handler table and the
+         *         number of outstanding SQEs referencing it. Keeping these
+         *         intrusively makes registration and completion O(1).
+         */
+        size_t slot = 0;
+        size_t refs = 0;
+        /** @brief Submission time of the latest request, only kept while
+         *         stats are enabled.
+         */
+        std::chrono::steady_clock::time_point submitted;
+
+        friend class IoUring;
+    };
+
+    /** @brief Counters describing the activity of the ring */
+    struct Stats
+    {
+        /** @brief The number of SQEs submitted for each opcode */
+        std::array<uint64_t, IORING_OP_LAST> ops = {};
+        /** @brief The number of SQEs submitted to the kernel */
+        uint64_t submitted = 0;
+        /** @brief The number of requests which posted their final CQE */
+        uint64_t completed = 0;
+        /** @brief The number of CQEs reaped, including multishot CQEs */
+        uint64_t cqes = 0;
+        /** @brief The number of CQEs which had no handler */
+        uint64_t unhandled = 0;
+        /** @brief The number of handlers replaced by setHandler() before
+         *         their SQE was submitted.
+         */
+        uint64_t replaced = 0;
+        /** @brief The number of times the CQ was found overflowing */
+        uint64_t overflows = 0;
+        /** @brief The number of CQEs the kernel dropped due to overflow */
+        uint64_t dropped = 0;
+        /** @brief Histogram of the time from submission to the final CQE
+         *         Bucket 0 counts latencies below 1us, bucket i counts
+         *         latencies in [2^(i-1), 2^i) us and the last bucket
+         *         counts everything above. Handlers shared by several
+         *         requests are timed from the latest submission.
+         */
+        std::array<uint64_t, 24> latency = {};
+
+        /** @brief The number of requests submitted but not yet completed */
+        inline uint64_t inflight() const noexcept
+        {
+            return submitted - completed;
+        }
+
+        /** @brief Prints a human readable summary of the counters
+         *
+         *  @param[in] stream - The stream to print to
+         */
+        void dump(std::FILE* stream) const;
+    };
+
+    /** @brief An awaitable operation which queues its SQE when awaited and
+     *         resumes the awaiting coroutine once the CQE is handled.
+     *  @details The awaitable is its own handler and lives in the coroutine
+     *           frame, so no allocation is needed per operation. The SQE is
+     *           sent to the kernel on the next submit(). The Op type provides
+     *           `void prep(io_uring_sqe&)` and `finish(const io_uring_cqe&)`
+     *           which produces the result of the co_await expression. Ops
+     *           with `bool resubmit(const io_uring_cqe&)` are prepared
+     *           again while it returns true, e.g. to continue after short
+     *           IO. Those SQEs are sent on the next submit() as well. If
+     *           preparing them fails, finish() still runs to settle the
+     *           op before the failure is rethrown by the co_await.
+     */
+    template <typename Op>
+    class [[nodiscard]] Awaitable : public CQEHandler
+    {
+      public:
+        template <typename... Args>
+        explicit Awaitable(IoUring& ring, Args&&... args) :
+            ring(ring), op{std::forward<Args>(args)...}
+        {}
+
+        constexpr bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> h)
+        {
+            queue();
+            handle = h;
+        }
+
+        decltype(auto) await_resume()
+        {
+            io_uring_cqe cqe{};
+            cqe.res = res;
+            cqe.flags = flags;
+            if (error)
+            {
+                try
+                {
+                    static_cast<void>(op.finish(cqe));
+                }
+                catch (...)
+                {}
+                std::rethrow_exception(error);
+            }
+            return op.finish(cqe);
+        }
+
+        void handleCQE(io_uring_cqe& cqe) noexcept override
+        {
+            res = cqe.res;
+            flags = cqe.flags;
+            if constexpr (requires { op.resubmit(cqe); })
+            {
+                if (op.resubmit(cqe))
+                {
+                    try
+                    {
+                        queue();
+                        return;
+                    }
+                    catch (...)
+                    {
+                        error = std::current_exception();
+                    }
+                }
+            }
+            handle.resume();
+        }
+
+      private:
+        IoUring& ring;
+        Op op;
+        std::coroutine_handle<> handle;
+        int32_t res = 0;
+        uint32_t flags = 0;
+        /** @brief Set if a resubmission failed to queue */
+        std::exception_ptr error;
+
+        void queue()
+        {
+            auto& sqe = ring.getSQE();
+            try
+            {
+                op.prep(sqe);
+            }
+            catch (...)
+            {
+                // The SQE is already part of the queue, make sure it isn't
+                // submitted with the stale request of its previous use
+                io_uring_prep_nop(&sqe);
+                throw;
+            }
+            ring.setHandler(sqe, this);
+        }
+    };
+
+    struct ReadOp
+    {
+        int fd;
+        std::span<std::byte> buf;
+        uint64_t offset;
+
+        void prep(io_uring_sqe& sqe) noexcept;
+        std::span<std::byte> finish(const io_uring_cqe& cqe) const;
+    };
+
+    struct WriteOp
+    {
+        int fd;
+        std::span<const std::byte> data;
+        uint64_t offset;
+
+        void prep(io_uring_sqe& sqe) noexcept;
+        std::span<const std::byte> finish(const io_uring_cqe& cqe) const;
+    };
+
+    struct AcceptOp
+    {
+        int fd;
+        SockAddrBuf* addr;
+        socklen_t len = 0;
+
+        void prep(io_uring_sqe& sqe) noexcept;
+        DupableFd finish(const io_uring_cqe& cqe);
+    };
+
+    struct ReadFixedOp
+    {
+        int fd;
+        std::span<std::byte> buf;
+        unsigned index;
+        uint64_t offset;
+
+        void prep(io_uring_sqe& sqe) noexcept;
+        std::span<std::byte> finish(const io_uring_cqe& cqe) const;
+    };
+
+    struct WriteFixedOp
+    {
+        int fd;
+        std::span<const std::byte> data;
+        unsigned index;
+        uint64_t offset;
+
+        void prep(io_uring_sqe& sqe) noexcept;
+        std::span<const std::byte> finish(const io_uring_cqe& cqe) const;
+    };
+
+    struct ReadExactOp
+    {
+        int fd;
+        std::span<std::byte> buf;
+        uint64_t offset;
+        size_t done = 0;
+
+        void prep(io_uring_sqe& sqe) noexcept;
+        bool resubmit(const io_uring_cqe& cqe) noexcept;
+        std::span<std::byte> finish(const io_uring_cqe& cqe) const;
+    };
+
+    struct WriteExactOp
+    {
+        int fd;
+        std::span<const std::byte> data;
+        uint64_t offset;
+        size_t done = 0;
+
+        void prep(io_uring_sqe& sqe) noexcept;
+        bool resubmit(const io_uring_cqe& cqe) noexcept;
+        std::span<const std::byte> finish(const io_uring_cqe& cqe) const;
+    };
+
+    /** @brief The container independent part of ReadAllOp */
+    struct ReadAllBase
+    {
+        int fd;
+        uint64_t offset;
+        size_t stride = 256;
+        size_t done = 0;
+
+        /** @brief Prepares a read into the container bytes after done */
+        void prep(io_uring_sqe& sqe, std::span<std::byte> buf) noexcept;
+        bool resubmit(const io_uring_cqe& cqe) noexcept;
+        /** @brief Checks the container resized to done bytes */
+        void finish(const io_uring_cqe& cqe, size_t size) const;
+    };
+
+    template <typename Container>
+    struct ReadAllOp : ReadAllBase
+    {
+        Container* container;
+
+        void prep(io_uring_sqe& sqe)
+        {
+            ReadAllBase::prep(sqe, resize(done + stride));
+        }
+
+        void finish(const io_uring_cqe& cqe) const
+        {
+            ReadAllBase::finish(cqe, resize(done).size());
+        }
+
+      private:
+        /** @brief Resizes the container to at least req bytes */
+        std::span<std::byte> resize(size_t req) const
+        {
+            using Data = raw::detail::dataType<Container>;
+            container->resize((req + sizeof(Data) - 1) / sizeof(Data));
+            return std::span(reinterpret_cast<std::byte*>(container->data()),
+                             container->size() * sizeof(Data));
+        }
+    };
+
+    struct FsyncOp
+    {
+        int fd;
+        bool datasync;
+
+        void prep(io_uring_sqe& sqe) noexcept;
+        void finish(const io_uring_cqe& cqe) const;
+    };
+
+    struct OpenatOp
+    {
+        int dirfd;
+        const char* path;
+        int flags;
+        mode_t mode;
+
+        void prep(io_uring_sqe& sqe) noexcept;
+        DupableFd finish(const io_uring_cqe& cqe) const;
+    };
+
+    struct StatxOp
+    {
+        int dirfd;
+        const char* path;
+        int flags;
+        unsigned mask;
+        struct statx* buf;
+
+        void prep(io_uring_sqe& sqe) noexcept;
+        struct statx& finish(const io_uring_cqe& cqe) const;
+    };
+
+    struct TimeoutOp
+    {
+        __kernel_timespec ts;
+
+        void prep(io_uring_sqe& sqe) noexcept;
+        void finish(const io_uring_cqe& cqe) const;
     };
 
     class FileHandle
@@ -48,8 +451,216 @@ class IoUring
         friend class IoUring;
     };
 
+    /** @brief A ring of provided buffers the kernel selects from when a
+     *         request has no buffer of its own.
+     *  @details Buffers are only consumed by requests with data ready, so
+     *           memory scales with in-flight data instead of the number of
+     *           pending requests.
+     */
+    class BufferRing
+    {
+      public:
+        /** @brief Allocates and registers a provided buffer ring
+         *
+         *  @param[in] ring    - The ring to register the buffers with
+         *  @param[in] group   - The buffer group id used to select buffers
+         *  @param[in] entries - The number of buffers, must be a power of 2
+         *  @param[in] size    - The size of each buffer in bytes
+         *  @throws std::system_error if the registration fails
+         */
+        BufferRing(IoUring& ring, uint16_t group, unsigned entries,
+                   size_t size);
+        BufferRing(BufferRing&&) = delete;
+        BufferRing& operator=(BufferRing&&) = delete;
+        BufferRing(const BufferRing&) = delete;
+        BufferRing& operator=(const BufferRing&) = delete;
+        ~BufferRing();
+
+        inline uint16_t getGroup() const noexcept
+        {
+            return group;
+        }
+
+        /** @brief Gets the data the kernel placed in a selected buffer
+         *
+         *  @param[in] cqe - The CQE which selected the buffer
+         *  @return The span of valid data, empty if no buffer was selected
+         */
+        std::span<std::byte> getData(const io_uring_cqe& cqe) const noexcept;
+
+        /** @brief Returns the buffer selected by the CQE back to the kernel
+         *
+         *  @param[in] cqe - The CQE which selected the buffer
+         */
+        void recycle(const io_uring_cqe& cqe) noexcept;
+
+      private:
+        IoUring& ring;
+        io_uring_buf_ring* br;
+        std::unique_ptr<std::byte[]> slab;
+        uint16_t group;
+        unsigned entries;
+        size_t size;
+    };
+
+    /** @brief A handler for requests which select from a BufferRing
+     *         The selected buffer is recycled after handleBuffer() returns.
+     */
+    class BufferHandler : public CQEHandler
+    {
+      public:
+        explicit BufferHandler(BufferRing& bufs) noexcept : bufs(bufs) {}
+
+        void handleCQE(io_uring_cqe& cqe) noexcept final;
+
+        /** @brief Handles the CQE along with the data of its buffer
+         *         The data is only valid for the duration of the call.
+         */
+        virtual void handleBuffer(io_uring_cqe& cqe,
+                                  std::span<std::byte> data) noexcept = 0;
+
+      private:
+        BufferRing& bufs;
+
+        friend class IoUring;
+    };
+
+    /** @brief A handler for zero copy sends
+     *  @details The kernel posts two CQEs for every send, the result of the
+     *           send followed by a notification once the kernel no longer
+     *           references the data. The data must stay valid until
+     *           handleRelease() is called, as must the handler itself.
+     */
+    class SendZCHandler : public CQEHandler
+    {
+      public:
+        void handleCQE(io_uring_cqe& cqe) noexcept final;
+
+        /** @brief Called with the result of a send
+         *         The data may still be in use by the kernel.
+         */
+        virtual void handleSent(io_uring_cqe& cqe) noexcept = 0;
+
+        /** @brief Called once the kernel released the data of a send,
+         *         always after the matching handleSent().
+         *
+         *  @param[in] copied - The kernel fell back to copying the data,
+         *                      only known if the send reported usage
+         */
+        virtual void handleRelease(bool copied) noexcept = 0;
+
+      private:
+        /** @brief The number of sends still waiting for their result */
+        size_t sending = 0;
+
+        friend class IoUring;
+    };
+
+    class BufferHandle
+    {
+      public:
+        inline std::span<std::byte> get() const noexcept
+        {
+            return buf;
+        }
+
+        inline unsigned index() const
+        {
+            return *slot;
+        }
+
+      private:
+        explicit BufferHandle(unsigned slot, std::span<std::byte> buf,
+                              IoUring& ring);
+
+        static void drop(unsigned&& slot, IoUring*& ring);
+
+        std::span<std::byte> buf;
+        Managed<unsigned, IoUring*>::Handle<drop> slot;
+
+        friend class IoUring;
+    };
+
+    /** @brief A sequence of requests linked with IOSQE_IO_LINK which is
+     *         handled as a single unit once every request completes.
+     *  @details Each request only starts once the previous one succeeded,
+     *           later requests complete with -ECANCELED after a failure.
+     *           Requests may carry a deadline which is queued as an
+     *           IORING_OP_LINK_TIMEOUT, a request cut short by its deadline
+     *           reports -ETIME. All requests of a chain must fit into the
+     *           submission queue at once. The chain is reusable after
+     *           handleChain() is called.
+     */
+    class Chain
+    {
+      public:
+        explicit Chain(IoUring& ring) noexcept : ring(ring) {}
+        Chain(Chain&&) = delete;
+        Chain& operator=(Chain&&) = delete;
+        Chain(const Chain&) = delete;
+        Chain& operator=(const Chain&) = delete;
+        virtual ~Chain() = default;
+
+        /** @brief Gets an SQE for the next request of the chain
+         *         The SQE must be prepared before adding the next request,
+         *         the link flag is applied afterwards.
+         *
+         *  @param[in] deadline - The maximum time the request may take
+         *  @throws std::system_error if the chain is in flight or the
+         *          submission queue has no space left. In the latter case
+         *          the requests added so far are queued as a shorter chain.
+         *  @return The SQE to prepare
+         */
+        io_uring_sqe& add();
+        io_uring_sqe& add(std::chrono::nanoseconds deadline);
+
+        /** @brief Finishes building the chain, the requests are sent to the
+         *         kernel on the next submit() of the ring.
+         *
+         *  @throws std::system_error if the chain is in flight or the
+         *          submission queue has no space left for the final
+         *          deadline. In the latter case the chain is queued without
+         *          the deadline.
+         */
+        void queue();
+
+        /** @brief Called once all requests of the chain completed
+         *
+         *  @param[in] res - The result of each request in the order added,
+         *                   valid until the chain is reused
+         */
+        virtual void handleChain(std::span<const int32_t> res) noexcept = 0;
+
+      private:
+        struct Link : CQEHandler
+        {
+            explicit Link(Chain& chain) noexcept : chain(chain) {}
+
+            void handleCQE(io_uring_cqe& cqe) noexcept override;
+
+            Chain& chain;
+            size_t op = 0;
+            bool deadline = false;
+            __kernel_timespec ts = {};
+        };
+
+        IoUring& ring;
+        std::deque<Link> links;
+        size_t linksUsed = 0;
+        std::vector<int32_t> res;
+        io_uring_sqe* last = nullptr;
+        std::optional<__kernel_timespec> lastDeadline;
+        size_t outstanding = 0;
+        bool queued = false;
+
+        Link& nextLink();
+        void linkLast(size_t needed);
+        void complete() noexcept;
+    };
+
     explicit IoUring(size_t queue_size = 10, int flags = 0);
     explicit IoUring(size_t queue_size, io_uring_params& params);
+    explicit IoUring(const Setup& setup);
 
     IoUring(IoUring&&) = delete;
     IoUring& operator=(IoUring&&) = delete;
@@ -58,6 +669,8 @@ class IoUring
     ~IoUring();
 
     /** @brief Reserves an additional number of file descriptor slots
+     *         The kernel table is registered once with room for thousands
+     *         of files, only reserving beyond it re-registers the table.
      *
      *  @param[in] num - The number of slots to register
      *  @throws std::system_error if the allocation fails
@@ -79,20 +692,109 @@ class IoUring
         return files;
     }
 
+    /** @brief Allocates and registers a slab of fixed buffers with the ring
+     *         Replaces any previously registered buffers.
+     *
+     *  @param[in] num  - The number of buffers
+     *  @param[in] size - The size of each buffer in bytes
+     *  @throws std::system_error if buffers are still leased or the
+     *          registration fails
+     */
+    void registerBuffers(size_t num, size_t size);
+
+    /** @brief Leases an unused fixed buffer from the registered slab
+     *
+     *  @throws std::system_error if no buffers are available
+     *  @return A handle to the fixed buffer, released when destroyed
+     */
+    [[nodiscard]] BufferHandle getBuffer();
+
     /** @brief Gets an unused SQE from the ring
+     *         Depending on setSQFull(), a full queue is submitted
+     *         implicitly, so previously acquired SQEs must be prepared
+     *         before requesting another.
      *
      *  @throws std::system_error if the allocation fails
      *  @return An SQE on the ring
      */
     io_uring_sqe& getSQE();
 
+    /** @brief Sets how getSQE() behaves when the submission queue is full
+     *         The default is SQFull::Throw.
+     *
+     *  @param[in] policy - The behavior when the queue is full
+     */
+    inline void setSQFull(SQFull policy) noexcept
+    {
+        sq_full = policy;
+    }
+
     /** @brief Associates the SQE with a user provided callback handler
+     *         A handler may be associated with multiple SQEs and will be
+     *         called once for each of them.
      *
      *  @param[in] sqe - The SQE that we want to register
      *  @param[in] h   - The handler which will be run when the CQE comes back
      */
     void setHandler(io_uring_sqe& sqe, CQEHandler* h) noexcept;
 
+    /** @brief Starts a multishot receive which selects buffers from the
+     *         handler's BufferRing. The handler is called for every
+     *         received chunk until a CQE arrives without IORING_CQE_F_MORE.
+     *
+     *  @param[in] fd    - The socket to receive from
+     *  @param[in] h     - The handler to call with received data
+     *  @param[in] flags - The flags passed to recv
+     *  @throws std::system_error if no SQE is available
+     */
+    void recvMultishot(int fd, BufferHandler& h, fd::RecvFlags flags = {});
+
+    /** @brief Starts a multishot accept. The handler is called with each
+     *         accepted descriptor in the CQE result until a CQE arrives
+     *         without IORING_CQE_F_MORE. The handler owns the descriptors.
+     *
+     *  @param[in] fd - The listening socket
+     *  @param[in] h  - The handler to call with each connection
+     *  @throws std::system_error if no SQE is available
+     */
+    void acceptMultishot(int fd, CQEHandler& h);
+
+    /** @brief Starts a zero copy send of the data
+     *         The handler is called with the result of the send and once
+     *         more when the data is released.
+     *
+     *  @param[in] fd     - The socket to send to
+     *  @param[in] data   - The data to send, valid until released
+     *  @param[in] h      - The handler to notify
+     *  @param[in] flags  - The flags passed to send
+     *  @param[in] report - Report if the data was copied on release,
+     *                      requires IORING_SEND_ZC_REPORT_USAGE (linux 6.2)
+     *  @throws std::system_error if no SQE is available
+     */
+    void sendZC(int fd, std::span<const std::byte> data, SendZCHandler& h,
+                fd::SendFlags flags = {}, bool report = false);
+
+    /** @brief Queues an IORING_OP_MSG_RING posting a message CQE to another
+     *         ring. The target ring passes it to its message handler, which
+     *         makes this a lock free way to wake up a ring from the thread
+     *         of another.
+     *
+     *  @param[in] target - The ring receiving the message
+     *  @param[in] data   - The value of the result of the message CQE
+     *  @throws std::system_error if no SQE is available
+     */
+    void msgRing(IoUring& target, int32_t data);
+
+    /** @brief Sets the handler called for messages received from msgRing()
+     *         Messages are dropped without a handler.
+     *
+     *  @param[in] h - The handler to call with each message CQE
+     */
+    inline void setMsgHandler(CQEHandler* h) noexcept
+    {
+        msg_handler = h;
+    }
+
     /** @brief Cancels the outstanding request associated with a handler
      *
      *  @param[in] h - The handler associated with the request
@@ -100,18 +802,222 @@ class IoUring
     void cancelHandler(CQEHandler& h);
 
     /** @brief Submits all outstanding SQEs to the kernel
+     *         With SQPOLL the syscall is skipped unless the poller is idle.
      *
      *  @throws std::system_error if the submission fails
      */
     void submit();
 
-    /** @brief Non-blocking process all outstanding CQEs */
-    void process() noexcept;
+    /** @brief Non-blocking process all outstanding CQEs
+     *         With DEFER_TASKRUN deferred completions are run first if no
+     *         CQEs are ready.
+     *
+     *  @throws std::system_error if deferred completions can't be run
+     */
+    void process();
+
+    /** @brief Non-blocking process of up to a bounded number of CQEs
+     *         CQEs without a handler are reaped but not counted.
+     *
+     *  @param[in] max - The maximum number of CQEs to handle
+     *  @return The number of CQEs passed to a handler
+     *  @throws std::system_error if deferred completions can't be run
+     */
+    size_t process(size_t max);
 
     /** @brief Waits for new CQEs to become available */
     void wait();
     void wait(std::chrono::nanoseconds timeout);
 
+    /** @brief Submits all outstanding SQEs and waits for CQEs using a single
+     *         syscall. Reaching the timeout is not an error, process()
+     *         handles whatever completed in the meantime.
+     *
+     *  @param[in] min_complete - The number of CQEs to wait for
+     *  @param[in] timeout      - The maximum amount of time to wait
+     *  @throws std::system_error if the submission fails
+     */
+    void submitAndWait(unsigned min_complete = 1);
+    void submitAndWait(unsigned min_complete, std::chrono::nanoseconds timeout);
+
+    /** @brief Runs submitAndWait() followed by process() until done
+     *         Larger batches trade latency for fewer syscalls, the timeout
+     *         bounds the latency of partial batches.
+     *
+     *  @param[in] done         - Checked before every iteration
+     *  @param[in] min_complete - The number of CQEs to wait for
+     *  @param[in] timeout      - The maximum amount of time to wait
+     *  @throws std::system_error if the submission fails
+     */
+    void runUntil(function_view<bool()> done, unsigned min_complete = 1);
+    void runUntil(function_view<bool()> done, unsigned min_complete,
+                  std::chrono::nanoseconds timeout);
+
+    /** @brief Enables or disables collecting Stats
+     *         Enabling resets the counters. Collecting stats costs walking
+     *         the SQ on submission and a clock read per batch of CQEs.
+     *
+     *  @param[in] enable - Whether to collect stats
+     */
+    void enableStats(bool enable = true);
+
+    /** @brief Gets the collected Stats
+     *
+     *  @return The stats, or nullptr if they are disabled
+     */
+    const Stats* getStats() noexcept;
+
+    /** @brief Asynchronously reads into the buffer when awaited
+     *
+     *  @param[in] fd     - The file descriptor to read from
+     *  @param[in] buf    - The buffer to read into
+     *  @param[in] offset - The file offset, or -1 for the current position
+     *  @throws std::system_error from the co_await on failure
+     *  @throws exception::Eof from the co_await at the end of the file
+     *  @return An awaitable producing the span of data read
+     */
+    Awaitable<ReadOp> read(int fd, std::span<std::byte> buf,
+                           uint64_t offset = -1);
+
+    /** @brief Asynchronously writes the data when awaited
+     *
+     *  @param[in] fd     - The file descriptor to write to
+     *  @param[in] data   - The data to write
+     *  @param[in] offset - The file offset, or -1 for the current position
+     *  @throws std::system_error from the co_await on failure
+     *  @return An awaitable producing the span of data written
+     */
+    Awaitable<WriteOp> write(int fd, std::span<const std::byte> data,
+                             uint64_t offset = -1);
+
+    /** @brief Asynchronously reads into a fixed buffer when awaited
+     *
+     *  @param[in] fd     - The file descriptor to read from
+     *  @param[in] buf    - The fixed buffer to read into
+     *  @param[in] offset - The file offset, or -1 for the current position
+     *  @throws std::system_error from the co_await on failure
+     *  @throws exception::Eof from the co_await at the end of the file
+     *  @return An awaitable producing the span of the buffer read into
+     */
+    Awaitable<ReadFixedOp> readFixed(int fd, const BufferHandle& buf,
+                                     uint64_t offset = -1);
+
+    /** @brief Asynchronously writes from a fixed buffer when awaited
+     *
+     *  @param[in] fd     - The file descriptor to write to
+     *  @param[in] buf    - The fixed buffer holding the data
+     *  @param[in] data   - The data to write, must be within the buffer
+     *  @param[in] offset - The file offset, or -1 for the current position
+     *  @throws std::system_error from the co_await on failure
+     *  @return An awaitable producing the span of data written
+     */
+    Awaitable<WriteFixedOp> writeFixed(int fd, const BufferHandle& buf,
+                                       std::span<const std::byte> data,
+                                       uint64_t offset = -1);
+
+    /** @brief Asynchronously reads until the buffer is full when awaited
+     *         Short reads are continued from where they stopped.
+     *
+     *  @param[in] fd     - The file descriptor to read from
+     *  @param[in] buf    - The buffer to fill
+     *  @param[in] offset - The file offset, or -1 for the current position
+     *  @throws std::system_error from the co_await on failure
+     *  @throws exception::Eof from the co_await if no data was read
+     *  @throws exception::Incomplete from the co_await if the end of the file
+     *          or an error is reached after a partial read
+     *  @return An awaitable producing the filled buffer
+     */
+    Awaitable<ReadExactOp> readExact(int fd, std::span<std::byte> buf,
+                                     uint64_t offset = -1);
+
+    /** @brief Asynchronously writes all of the data when awaited
+     *         Short writes are continued from where they stopped.
+     *
+     *  @param[in] fd     - The file descriptor to write to
+     *  @param[in] data   - The data to write
+     *  @param[in] offset - The file offset, or -1 for the current position
+     *  @throws std::system_error from the co_await on failure
+     *  @throws exception::Incomplete from the co_await if an error is
+     *          reached after a partial write, or the file takes no data
+     *  @return An awaitable producing the written data
+     */
+    Awaitable<WriteExactOp> writeExact(int fd, std::span<const std::byte> data,
+                                       uint64_t offset = -1);
+
+    /** @brief Asynchronously reads until the end of the file into the
+     *         container when awaited. The container grows as needed and is
+     *         resized to the data read once done.
+     *
+     *  @param[in] fd     - The file descriptor to read from
+     *  @param[in] c      - The container to read into, must outlive the read
+     *  @param[in] offset - The file offset, or -1 for the current position
+     *  @throws std::system_error from the co_await on failure, the container
+     *          holds the data read before the failure
+     *  @throws exception::Incomplete from the co_await if the data doesn't
+     *          fill a whole number of container elements
+     *  @return An awaitable completing at the end of the file
+     */
+    template <typename Container>
+    Awaitable<ReadAllOp<Container>> readAll(int fd, Container& c,
+                                            uint64_t offset = -1)
+    {
+        return Awaitable<ReadAllOp<Container>>(
+            *this, ReadAllBase{fd, offset}, &c);
+    }
+
+    /** @brief Asynchronously flushes the file to storage when awaited
+     *
+     *  @param[in] fd       - The file descriptor to flush
+     *  @param[in] datasync - Only flush the metadata needed to read the data
+     *  @throws std::system_error from the co_await on failure
+     *  @return An awaitable completing once the data is stored
+     */
+    Awaitable<FsyncOp> fsync(int fd, bool datasync = false);
+
+    /** @brief Asynchronously opens a file when awaited
+     *
+     *  @param[in] path  - The path to open, must outlive the open
+     *  @param[in] flags - The flags passed to open
+     *  @param[in] mode  - The mode used when creating the file
+     *  @param[in] dirfd - The directory relative paths are resolved in
+     *  @throws std::system_error from the co_await on failure
+     *  @return An awaitable producing the opened file
+     */
+    Awaitable<OpenatOp> openat(const_zstring path, fd::OpenFlags flags,
+                               mode_t mode = 0, int dirfd = AT_FDCWD);
+
+    /** @brief Asynchronously gets the status of a file when awaited
+     *
+     *  @param[in] path  - The path to the file, must outlive the call
+     *  @param[in] buf   - Populated with the status
+     *  @param[in] flags - The AT_* flags passed to statx
+     *  @param[in] mask  - The STATX_* fields requested
+     *  @param[in] dirfd - The directory relative paths are resolved in
+     *  @throws std::system_error from the co_await on failure
+     *  @return An awaitable producing the populated buffer
+     */
+    Awaitable<StatxOp> statx(const_zstring path, struct statx& buf,
+                             int flags = 0, unsigned mask = STATX_BASIC_STATS,
+                             int dirfd = AT_FDCWD);
+
+    /** @brief Asynchronously accepts a connection when awaited
+     *
+     *  @param[in] fd   - The listening socket
+     *  @param[in] addr - Populated with the peer address if provided
+     *  @throws std::system_error from the co_await on failure
+     *  @return An awaitable producing the accepted connection
+     */
+    Awaitable<AcceptOp> accept(int fd);
+    Awaitable<AcceptOp> accept(int fd, SockAddrBuf& addr);
+
+    /** @brief Asynchronously sleeps for the duration when awaited
+     *
+     *  @param[in] timeout - The amount of time to wait
+     *  @throws std::system_error from the co_await if cancelled
+     *  @return An awaitable completing after the timeout
+     */
+    Awaitable<TimeoutOp> timeout(std::chrono::nanoseconds timeout);
+
     /** @brief Returns the EventFD associated with the ring
      *         A new descriptor is created if it does not yet exist
      *
@@ -120,19 +1026,50 @@ class IoUring
      */
     ManagedFd& getEventFd();
 
+    /** @brief Adds the EventFD to an external epoll instance
+     *         processEvents() should be called once it is readable.
+     *
+     *  @param[in] epfd - The epoll instance
+     *  @param[in] data - The user data reported by epoll for the EventFD
+     *  @throws std::system_error if the registration fails
+     */
+    void registerEpoll(int epfd, uint64_t data = 0);
+
     /** @brief Non-blocking process all outstanding eventFd events
      *         Should be used instead of process() to clear eventFd events.
+     *         The EventFD is not signalled for completions arriving while
+     *         they are being processed (IORING_CQ_EVENTFD_DISABLED), so a
+     *         busy ring coalesces them into a single wakeup.
      */
     void processEvents();
 
   private:
     io_uring ring;
     std::optional<ManagedFd> event_fd;
+    SQFull sq_full = SQFull::Throw;
+    bool in_process = false;
+    CQEHandler* msg_handler = nullptr;
     std::vector<CQEHandler*> handlers;
     std::vector<int> files;
+    std::vector<unsigned> filesFree;
     size_t filesAllocated = 0;
+    /** @brief The number of slots in the table registered with the kernel,
+     *         files only covers those handed out so far.
+     */
+    size_t filesCapacity = 0;
+    std::unique_ptr<std::byte[]> bufSlab;
+    size_t bufSize = 0;
+    size_t bufNum = 0;
+    std::vector<unsigned> bufFree;
+    std::unique_ptr<Stats> stats;
 
+    void countSQEs() noexcept;
+    void countCQE(CQEHandler* h, const io_uring_cqe& cqe,
+                  std::chrono::steady_clock::time_point now) noexcept;
     void dropHandler(CQEHandler* h, io_uring_cqe& cqe) noexcept;
+    void growFiles(size_t size);
+    void registerFileTable(size_t size);
+    int installFileTable(std::span<const int> table) noexcept;
     void setFile(unsigned slot, int fd) noexcept;
     void updateFile(unsigned slot, int fd);
 };
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <stdplus/io_uring.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace stdplus
+{
+
+/** @brief Runs tasks on a set of IoUring shards, each owned by a thread
+ *  @details Every shard has its own ring and task queues guarded by a lock
+ *           per shard, there is no lock shared between shards. Idle shards
+ *           sleep in their ring and are woken up with IORING_OP_MSG_RING,
+ *           so a shard waits for both its IO and new tasks in one syscall.
+ *           Tasks posted to a shard always run on it, which lets them use
+ *           state owned by the ring like registered files. Spawned tasks
+ *           may be stolen by idle shards.
+ */
+class IoUringExecutor
+{
+  public:
+    /** @brief A task, run with the ring of the shard executing it
+     *         Exceptions escaping a task are logged and ignored.
+     */
+    using Task = std::move_only_function<void(IoUring&)>;
+
+    /** @brief Starts the shards
+     *
+     *  @param[in] shards - The number of shards to run
+     *  @param[in] setup  - The parameters of every ring
+     *  @param[in] cpus   - The CPUs the shards are pinned to round robin,
+     *                      no pinning if empty
+     *  @throws std::system_error if a shard fails to start
+     *  @details The rings are created by the shard threads, so single
+     *           issuer setups like IoUring::Setup::deferTaskrun() work.
+     *           The rings submit implicitly when their SQ is full. A shard
+     *           whose ring fails logs the error and stops, its spawned
+     *           tasks are still stolen by the other shards. Its pinned
+     *           tasks are dropped and posting to it throws.
+     */
+    explicit IoUringExecutor(size_t shards,
+                             const IoUring::Setup& setup = IoUring::Setup(),
+                             std::span<const unsigned> cpus = {});
+    IoUringExecutor(IoUringExecutor&&) = delete;
+    IoUringExecutor& operator=(IoUringExecutor&&) = delete;
+    IoUringExecutor(const IoUringExecutor&) = delete;
+    IoUringExecutor& operator=(const IoUringExecutor&) = delete;
+    ~IoUringExecutor();
+
+    inline size_t size() const noexcept
+    {
+        return shards.size();
+    }
+
+    /** @brief Gets the shard which owns the file descriptor
+     *
+     *  @throws std::system_error if the file descriptor is negative
+     */
+    size_t shardFor(int fd) const;
+
+    /** @brief Gets the shard of the calling thread
+     *
+     *  @return The index of the shard, or std::nullopt if the thread does
+     *          not belong to this executor
+     */
+    std::optional<size_t> currentShard() const noexcept;
+
+    /** @brief Queues a task which is only run by the given shard
+     *
+     *  @param[in] shard - The index of the shard
+     *  @param[in] task  - The task to run
+     *  @throws std::system_error if the shard failed or can't be woken up
+     */
+    void post(size_t shard, Task task);
+
+    /** @brief Queues a task on the shard which owns the file descriptor
+     *
+     *  @throws std::system_error if the file descriptor is negative, or
+     *          the shard failed or can't be woken up
+     */
+    inline void postFd(int fd, Task task)
+    {
+        post(shardFor(fd), std::move(task));
+    }
+
+    /** @brief Queues a task which may run on any shard
+     *         The task is queued on the calling shard, or on the shards
+     *         round robin when called from another thread.
+     *
+     *  @param[in] task - The task to run
+     *  @throws std::system_error if a shard can't be woken up
+     */
+    void spawn(Task task);
+
+    /** @brief Stops all shards once their queued tasks have run
+     *         Outstanding IO is cancelled when the executor is destroyed.
+     *         Safe to call from any thread, including the shards.
+     *
+     *  @throws std::system_error if a shard can't be woken up
+     */
+    void stop();
+
+  private:
+    struct Shard : IoUring::CQEHandler
+    {
+        std::optional<IoUring> ring;
+        std::mutex lock;
+        std::deque<Task> pinned;
+        std::deque<Task> shared;
+        std::atomic<bool> idle = false;
+        /** @brief Set under the lock once the ring failed while running */
+        bool dead = false;
+        /** @brief Set if the ring fails to start */
+        std::exception_ptr error;
+        std::thread thread;
+
+        /** @brief Message CQEs only exist to wake up the ring */
+        void handleCQE(io_uring_cqe&) noexcept override {}
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::atomic<size_t> next = 0;
+    std::atomic<bool> stopping = false;
+    /** @brief Sends wakeups for threads which don't own a ring */
+    std::mutex outsideLock;
+    IoUring outside;
+
+    /** @brief Stops and joins the first started shards on a failed start */
+    void abort(size_t started) noexcept;
+    void run(Shard& shard, size_t idx) noexcept;
+    void runLoop(Shard& shard, size_t idx);
+    Task take(size_t idx);
+    bool hasWork(size_t idx);
+    bool wake(Shard& shard);
+    void wakeIdle(size_t idx);
+};
+
+} // namespace stdplus
@@ -1,12 +1,18 @@
+#include <stdplus/exception.hpp>
 #include <stdplus/fd/fmt.hpp>
 #include <stdplus/fd/ops.hpp>
 
+#include <array>
+#include <utility>
+
 namespace stdplus
 {
 namespace fd
 {
 
-FormatBuffer::FormatBuffer(Fd& fd, size_t max) : fd(fd), max(max) {}
+FormatBuffer::FormatBuffer(Fd& fd, size_t max, bool double_buffer) :
+    fd(fd), max(max), double_buffer(double_buffer)
+{}
 
 FormatBuffer::~FormatBuffer() noexcept(false)
 {
@@ -15,19 +21,76 @@ FormatBuffer::~FormatBuffer() noexcept(false)
 
 void FormatBuffer::flush()
 {
-    if (buf.size() > 0)
+    if (double_buffer || pending.size() > 0)
+    {
+        // Track each write so a short one never loses buffered output
+        auto left = buffered();
+        while (!tryFlush())
+        {
+            if (buffered() == left)
+            {
+                throw exception::WouldBlock("FormatBuffer flush");
+            }
+            left = buffered();
+        }
+    }
+    else if (buf.size() > 0)
     {
         writeExact(fd, buf);
         buf.clear();
     }
 }
 
+bool FormatBuffer::tryFlush()
+{
+    if (pending.size() == 0)
+    {
+        std::swap(buf, pending);
+    }
+    if (pending.size() == 0)
+    {
+        blocked = false;
+        return true;
+    }
+    std::array<iovec, 2> iov = {
+        iovec{pending.data() + pending_off, pending.size() - pending_off},
+        iovec{buf.data(), buf.size()}};
+    auto r = writev(fd, std::span(iov).first(buf.size() > 0 ? 2 : 1));
+    pending_off += r;
+    if (pending_off >= pending.size())
+    {
+        // Whatever was written from the second buffer becomes the offset
+        // into it as it is set aside
+        pending_off -= pending.size();
+        pending.clear();
+        std::swap(buf, pending);
+        if (pending_off == pending.size())
+        {
+            pending.clear();
+            pending_off = 0;
+        }
+    }
+    blocked = buffered() != 0;
+    return !blocked;
+}
+
 void FormatBuffer::writeIfNeeded()
 {
-    if (buf.size() >= max)
+    if (!double_buffer)
+    {
+        if (buf.size() >= max)
+        {
+            flush();
+        }
+    }
+    else if (buffered() > 2 * max)
     {
         flush();
     }
+    else if (!blocked && buf.size() >= max)
+    {
+        tryFlush();
+    }
 }
 
 } // namespace fd
@@ -1,12 +1,15 @@
 #include <fcntl.h>
 #include <sys/ioctl.h>
+#include <sys/sendfile.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include <stdplus/exception.hpp>
 #include <stdplus/fd/impl.hpp>
 #include <stdplus/util/cexec.hpp>
 
+#include <algorithm>
 #include <format>
 #include <string_view>
 
@@ -18,23 +21,34 @@ namespace fd
 using namespace std::literals::string_view_literals;
 
 template <typename Byte>
-static std::span<Byte> fret(std::span<Byte> buf, const char* name, ssize_t r)
+static IOResult<std::span<Byte>> tret(std::span<Byte> buf, ssize_t r) noexcept
 {
     if (r == -1)
     {
         if (errno == EAGAIN || errno == EWOULDBLOCK)
         {
-            return {};
+            return std::span<Byte>{};
         }
-        throw util::makeSystemError(errno, name);
+        return std::unexpected(IOError{errno});
     }
     else if (r == 0 && buf.size() > 0)
     {
-        throw exception::Eof(name);
+        return std::unexpected(IOError{0});
     }
     return buf.subspan(0, r);
 }
 
+template <typename Byte>
+static std::span<Byte> fret(std::span<Byte> buf, const char* name, ssize_t r)
+{
+    auto ret = tret(buf, r);
+    if (!ret)
+    {
+        ret.error().raise(name);
+    }
+    return *ret;
+}
+
 std::span<std::byte> FdImpl::read(std::span<std::byte> buf)
 {
     return fret(buf, "read", ::read(get(), buf.data(), buf.size()));
@@ -46,6 +60,31 @@ std::span<std::byte> FdImpl::recv(std::span<std::byte> buf, RecvFlags flags)
                 ::recv(get(), buf.data(), buf.size(), static_cast<int>(flags)));
 }
 
+IOResult<std::span<std::byte>> FdImpl::tryRead(std::span<std::byte> buf)
+{
+    return tret(buf, ::read(get(), buf.data(), buf.size()));
+}
+
+IOResult<std::span<std::byte>> FdImpl::tryRecv(std::span<std::byte> buf,
+                                               RecvFlags flags)
+{
+    return tret(buf, ::recv(get(), buf.data(), buf.size(),
+                            static_cast<int>(flags)));
+}
+
+IOResult<std::span<const std::byte>> FdImpl::tryWrite(
+    std::span<const std::byte> data)
+{
+    return tret(data, ::write(get(), data.data(), data.size()));
+}
+
+IOResult<std::span<const std::byte>> FdImpl::trySend(
+    std::span<const std::byte> data, SendFlags flags)
+{
+    return tret(data, ::send(get(), data.data(), data.size(),
+                             static_cast<int>(flags)));
+}
+
 std::tuple<std::span<std::byte>, std::span<std::byte>> FdImpl::recvfrom(
     std::span<std::byte> buf, RecvFlags flags, std::span<std::byte> sockaddr)
 {
@@ -82,6 +121,147 @@ std::span<const std::byte> FdImpl::sendto(std::span<const std::byte> data,
                  sockaddr.size()));
 }
 
+std::span<std::byte> FdImpl::pread(std::span<std::byte> buf, off_t offset)
+{
+    return fret(buf, "pread",
+                ::pread(get(), buf.data(), buf.size(), offset));
+}
+
+std::span<const std::byte> FdImpl::pwrite(std::span<const std::byte> data,
+                                          off_t offset)
+{
+    return fret(data, "pwrite",
+                ::pwrite(get(), data.data(), data.size(), offset));
+}
+
+static size_t cret(size_t len, const char* name, ssize_t r)
+{
+    if (r == -1)
+    {
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            return 0;
+        }
+        throw util::makeSystemError(errno, name);
+    }
+    else if (r == 0 && len > 0)
+    {
+        throw exception::Eof(name);
+    }
+    return r;
+}
+
+static off_t* optOff(std::optional<off_t>& offset)
+{
+    return offset ? &*offset : nullptr;
+}
+
+/** @brief The kernel only copies between file descriptors it knows about */
+static int outFd(Fd& out, const char* name)
+{
+    auto impl = dynamic_cast<FdImpl*>(&out);
+    if (impl == nullptr)
+    {
+        throw util::makeSystemError(EBADF, name);
+    }
+    return impl->get();
+}
+
+size_t FdImpl::copyFileRange(std::optional<off_t> offset, Fd& out,
+                             std::optional<off_t> out_offset, size_t len)
+{
+    return cret(len, "copy_file_range",
+                ::copy_file_range(get(), optOff(offset),
+                                  outFd(out, "copy_file_range"),
+                                  optOff(out_offset), len, 0));
+}
+
+size_t FdImpl::splice(std::optional<off_t> offset, Fd& out,
+                      std::optional<off_t> out_offset, size_t len,
+                      SpliceFlags flags)
+{
+    return cret(len, "splice",
+                ::splice(get(), optOff(offset), outFd(out, "splice"),
+                         optOff(out_offset), len, static_cast<int>(flags)));
+}
+
+size_t FdImpl::sendfile(Fd& out, std::optional<off_t> offset, size_t len)
+{
+    return cret(len, "sendfile",
+                ::sendfile(outFd(out, "sendfile"), get(), optOff(offset),
+                           len));
+}
+
+static size_t mret(const char* name, int r)
+{
+    if (r == -1)
+    {
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            return 0;
+        }
+        throw util::makeSystemError(errno, name);
+    }
+    return r;
+}
+
+size_t FdImpl::recvmmsg(std::span<mmsghdr> msgs, RecvFlags flags)
+{
+    return mret("recvmmsg", ::recvmmsg(get(), msgs.data(), msgs.size(),
+                                       static_cast<int>(flags), nullptr));
+}
+
+size_t FdImpl::sendmmsg(std::span<mmsghdr> msgs, SendFlags flags)
+{
+    return mret("sendmmsg", ::sendmmsg(get(), msgs.data(), msgs.size(),
+                                       static_cast<int>(flags)));
+}
+
+static size_t vret(std::span<const iovec> iov, const char* name, ssize_t r)
+{
+    if (r == -1)
+    {
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            return 0;
+        }
+        throw util::makeSystemError(errno, name);
+    }
+    else if (r == 0 && std::ranges::any_of(iov, [](const iovec& v) {
+                 return v.iov_len > 0;
+             }))
+    {
+        throw exception::Eof(name);
+    }
+    return r;
+}
+
+size_t FdImpl::readv(std::span<const iovec> iov)
+{
+    return vret(iov, "readv", ::readv(get(), iov.data(), iov.size()));
+}
+
+size_t FdImpl::writev(std::span<const iovec> iov)
+{
+    return vret(iov, "writev", ::writev(get(), iov.data(), iov.size()));
+}
+
+size_t FdImpl::preadv2(std::span<const iovec> iov, off_t offset,
+                       RWFlags flags)
+{
+    return vret(iov, "preadv2",
+                ::preadv2(get(), iov.data(), iov.size(), offset,
+                          static_cast<int>(flags)));
+}
+
+size_t FdImpl::pwritev2(std::span<const iovec> iov, off_t offset,
+                        RWFlags flags)
+{
+    return vret(iov, "pwritev2",
+                ::pwritev2(get(), iov.data(), iov.size(), offset,
+                           static_cast<int>(flags)));
+}
+
 static std::string_view whenceStr(Whence whence)
 {
     switch (whence)
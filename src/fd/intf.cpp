@@ -0,0 +1,142 @@
+#include <stdplus/exception.hpp>
+#include <stdplus/fd/intf.hpp>
+#include <stdplus/util/cexec.hpp>
+
+namespace stdplus
+{
+namespace fd
+{
+
+void IOError::raise(const char* name) const
+{
+    if (eof())
+    {
+        throw exception::Eof(name);
+    }
+    throw util::makeSystemError(err, name);
+}
+
+template <typename F>
+static auto tryOp(F&& f) -> IOResult<decltype(f())>
+{
+    try
+    {
+        return f();
+    }
+    catch (const exception::Eof&)
+    {
+        return std::unexpected(IOError{0});
+    }
+    catch (const std::system_error& e)
+    {
+        return std::unexpected(IOError{e.code().value()});
+    }
+}
+
+IOResult<std::span<std::byte>> Fd::tryRead(std::span<std::byte> buf)
+{
+    return tryOp([&] { return read(buf); });
+}
+
+IOResult<std::span<std::byte>> Fd::tryRecv(std::span<std::byte> buf,
+                                           RecvFlags flags)
+{
+    return tryOp([&] { return recv(buf, flags); });
+}
+
+IOResult<std::span<const std::byte>> Fd::tryWrite(
+    std::span<const std::byte> data)
+{
+    return tryOp([&] { return write(data); });
+}
+
+IOResult<std::span<const std::byte>> Fd::trySend(
+    std::span<const std::byte> data, SendFlags flags)
+{
+    return tryOp([&] { return send(data, flags); });
+}
+
+/** @brief Gets the first buffer which can transfer data */
+static std::span<std::byte> firstIov(std::span<const iovec> iov) noexcept
+{
+    for (const auto& v : iov)
+    {
+        if (v.iov_len > 0)
+        {
+            return {static_cast<std::byte*>(v.iov_base), v.iov_len};
+        }
+    }
+    return {};
+}
+
+std::span<std::byte> Fd::pread(std::span<std::byte>, off_t)
+{
+    throw util::makeSystemError(ENOSYS, "Fd::pread");
+}
+
+std::span<const std::byte> Fd::pwrite(std::span<const std::byte>, off_t)
+{
+    throw util::makeSystemError(ENOSYS, "Fd::pwrite");
+}
+
+size_t Fd::copyFileRange(std::optional<off_t>, Fd&, std::optional<off_t>,
+                         size_t)
+{
+    throw util::makeSystemError(ENOSYS, "Fd::copyFileRange");
+}
+
+size_t Fd::splice(std::optional<off_t>, Fd&, std::optional<off_t>, size_t,
+                  SpliceFlags)
+{
+    throw util::makeSystemError(ENOSYS, "Fd::splice");
+}
+
+size_t Fd::sendfile(Fd&, std::optional<off_t>, size_t)
+{
+    throw util::makeSystemError(ENOSYS, "Fd::sendfile");
+}
+
+size_t Fd::recvmmsg(std::span<mmsghdr>, RecvFlags)
+{
+    throw util::makeSystemError(ENOSYS, "Fd::recvmmsg");
+}
+
+size_t Fd::sendmmsg(std::span<mmsghdr>, SendFlags)
+{
+    throw util::makeSystemError(ENOSYS, "Fd::sendmmsg");
+}
+
+size_t Fd::readv(std::span<const iovec> iov)
+{
+    auto buf = firstIov(iov);
+    return buf.empty() ? 0 : read(buf).size();
+}
+
+size_t Fd::writev(std::span<const iovec> iov)
+{
+    auto buf = firstIov(iov);
+    return buf.empty() ? 0 : write(buf).size();
+}
+
+size_t Fd::preadv2(std::span<const iovec> iov, off_t offset, RWFlags flags)
+{
+    if (static_cast<int>(flags) != 0)
+    {
+        throw util::makeSystemError(ENOSYS, "Fd::preadv2");
+    }
+    auto buf = firstIov(iov);
+    return buf.empty() ? 0 : pread(buf, offset).size();
+}
+
+size_t Fd::pwritev2(std::span<const iovec> iov, off_t offset, RWFlags flags)
+{
+    if (static_cast<int>(flags) != 0)
+    {
+        throw util::makeSystemError(ENOSYS, "Fd::pwritev2");
+    }
+    auto buf = firstIov(iov);
+    return buf.empty() ? 0 : pwrite(buf, offset).size();
+}
+
+} // namespace fd
+} // namespace stdplus
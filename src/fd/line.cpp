@@ -1,7 +1,8 @@
-#include <stdplus/exception.hpp>
 #include <stdplus/fd/line.hpp>
 #include <stdplus/fd/ops.hpp>
+#include <stdplus/util/cexec.hpp>
 
+#include <algorithm>
 #include <cstring>
 
 namespace stdplus
@@ -9,53 +10,224 @@ namespace stdplus
 namespace fd
 {
 
-LineReader::LineReader(Fd& fd) : fd(fd) {}
+LineReader::LineReader(Fd& fd) : fd(fd)
+{
+    buf = inline_buf;
+}
+
+LineReader::LineReader(Fd& fd, size_t size) : fd(fd)
+{
+    if (size == 0)
+    {
+        throw util::makeSystemError(EINVAL, "LineReader");
+    }
+    if (size <= inline_buf.size())
+    {
+        buf = std::span(inline_buf).first(size);
+    }
+    else
+    {
+        heap_buf.resize(size);
+        buf = heap_buf;
+    }
+}
+
+LineReader::LineReader(LineReader&& other) noexcept : fd(other.fd)
+{
+    *this = std::move(other);
+}
+
+LineReader& LineReader::operator=(LineReader&& other) noexcept
+{
+    if (this == &other)
+    {
+        return *this;
+    }
+    // The buffer spans point into the inline buffer of the other reader,
+    // they need to be rebased onto ours
+    auto off = other.buf_data.empty()
+                   ? 0
+                   : other.buf_data.data() - other.buf.data();
+    fd = other.fd;
+    inline_buf = other.inline_buf;
+    heap_buf = std::move(other.heap_buf);
+    buf = heap_buf.empty() ? std::span(inline_buf).first(other.buf.size())
+                           : std::span(heap_buf);
+    buf_data = buf.subspan(off, other.buf_data.size());
+    line = std::move(other.line);
+    delim = std::move(other.delim);
+    max_line = other.max_line;
+    line_complete = other.line_complete;
+    hit_eof = other.hit_eof;
+    skip_line = other.skip_line;
+    return *this;
+}
+
+void LineReader::setDelimiter(std::string_view delim)
+{
+    if (delim.empty() || delim.size() > buf.size())
+    {
+        throw util::makeSystemError(EINVAL, "LineReader delimiter");
+    }
+    this->delim = delim;
+}
 
 const std::string* LineReader::readLine()
+{
+    auto ret = tryReadLine();
+    if (!ret)
+    {
+        ret.error().raise("readLine");
+    }
+    return *ret;
+}
+
+std::optional<std::string_view> LineReader::readLineView()
+{
+    if (!hit_eof && !skip_line && (line_complete || line.empty()))
+    {
+        line.clear();
+        line_complete = false;
+        if (buf_data.empty())
+        {
+            auto ret = fill();
+            if (!ret)
+            {
+                ret.error().raise("readLine");
+            }
+            if (hit_eof)
+            {
+                return line;
+            }
+            if (!*ret)
+            {
+                return std::nullopt;
+            }
+        }
+        // The line is entirely buffered, there is nothing to join
+        if (auto i = findDelim(); i && *i <= max_line)
+        {
+            std::string_view ret(buf_data.data(), *i);
+            buf_data = buf_data.subspan(*i + delim.size());
+            line_complete = true;
+            return ret;
+        }
+    }
+    auto ret = readLine();
+    if (ret == nullptr)
+    {
+        return std::nullopt;
+    }
+    return *ret;
+}
+
+IOResult<bool> LineReader::fill()
+{
+    auto kept = buf_data.size();
+    std::memmove(buf.data(), buf_data.data(), kept);
+    auto ret = tryRead(fd, std::span(buf).subspan(kept));
+    if (!ret)
+    {
+        if (!ret.error().eof())
+        {
+            return std::unexpected(ret.error());
+        }
+        buf_data = std::span(buf).first(kept);
+        hit_eof = true;
+        return false;
+    }
+    buf_data = std::span(buf).first(kept + ret->size());
+    return !ret->empty();
+}
+
+std::optional<size_t> LineReader::findDelim() const noexcept
+{
+    // find() is built on memchr, which libc vectorizes for every
+    // architecture we run on
+    auto i = std::string_view(buf_data.data(), buf_data.size()).find(delim);
+    if (i == std::string_view::npos)
+    {
+        return std::nullopt;
+    }
+    return i;
+}
+
+IOResult<void> LineReader::append(size_t len)
+{
+    auto data = buf_data.first(len);
+    buf_data = buf_data.subspan(len);
+    if (skip_line)
+    {
+        return {};
+    }
+    if (len > max_line - line.size())
+    {
+        line.clear();
+        skip_line = true;
+        return std::unexpected(IOError{EMSGSIZE});
+    }
+    line.append(data.data(), data.size());
+    return {};
+}
+
+IOResult<const std::string*> LineReader::tryReadLine()
 {
     if (hit_eof)
     {
-        throw exception::Eof("readLine");
+        return std::unexpected(IOError{0});
     }
     if (line_complete)
     {
         line.clear();
+        line_complete = false;
     }
     while (true)
     {
-        if (buf_data.empty())
+        if (auto i = findDelim(); i)
         {
-            try
+            auto ret = append(*i);
+            buf_data = buf_data.subspan(delim.size());
+            if (skip_line)
             {
-                buf_data = read(fd, buf);
-                if (buf_data.empty())
+                // The delimiter ends the line being skipped
+                skip_line = false;
+                if (!ret)
                 {
-                    return nullptr;
+                    return std::unexpected(ret.error());
                 }
+                continue;
             }
-            catch (const exception::Eof&)
-            {
-                hit_eof = true;
-                return &line;
-            }
+            line_complete = true;
+            return &line;
         }
-        line_complete = false;
-        for (size_t i = 0; i < buf_data.size(); ++i)
+        // The start of a delimiter could be at the end of the buffer, keep
+        // it for matching against the next read
+        auto keep = std::min(buf_data.size(), delim.size() - 1);
+        if (auto ret = append(buf_data.size() - keep); !ret)
+        {
+            return std::unexpected(ret.error());
+        }
+        auto ret = fill();
+        if (!ret)
+        {
+            return std::unexpected(ret.error());
+        }
+        if (hit_eof)
         {
-            if (buf_data[i] == '\n')
+            if (auto ret = append(buf_data.size()); !ret)
+            {
+                return std::unexpected(ret.error());
+            }
+            if (skip_line)
             {
-                auto oldsize = line.size();
-                line.resize(oldsize + i);
-                std::memcpy(line.data() + oldsize, buf_data.data(), i);
-                buf_data = buf_data.subspan(i + 1);
-                line_complete = true;
-                return &line;
+                return std::unexpected(IOError{0});
             }
+            return &line;
+        }
+        if (!*ret)
+        {
+            return nullptr;
         }
-        auto oldsize = line.size();
-        line.resize(oldsize + buf_data.size());
-        std::memcpy(line.data() + oldsize, buf_data.data(), buf_data.size());
-        buf_data = {};
     }
 }
 
@@ -0,0 +1,103 @@
+#include <stdplus/fd/mmsg.hpp>
+#include <stdplus/util/cexec.hpp>
+
+#include <algorithm>
+
+namespace stdplus
+{
+namespace fd
+{
+
+MsgBatch::MsgBatch(size_t msgs, size_t msg_size) :
+    msg_size(msg_size), bufs(msgs * msg_size), addrs(msgs), iovs(msgs),
+    hdrs(msgs)
+{
+    this->msgs.reserve(msgs);
+    for (size_t i = 0; i < msgs; ++i)
+    {
+        iovs[i].iov_base = slot(i).data();
+        hdrs[i].msg_hdr.msg_iov = &iovs[i];
+        hdrs[i].msg_hdr.msg_iovlen = 1;
+    }
+}
+
+std::span<const MsgBatch::Msg> MsgBatch::recv(Fd& fd, RecvFlags flags)
+{
+    clear();
+    msgs.clear();
+    for (size_t i = 0; i < hdrs.size(); ++i)
+    {
+        iovs[i].iov_len = msg_size;
+        auto& hdr = hdrs[i].msg_hdr;
+        hdr.msg_name = static_cast<sockaddr*>(addrs[i]);
+        hdr.msg_namelen = SockAddrBuf::maxLen;
+        hdr.msg_flags = 0;
+    }
+    auto n = fd.recvmmsg(hdrs, flags);
+    for (size_t i = 0; i < n; ++i)
+    {
+        const auto& hdr = hdrs[i];
+        addrs[i].len = hdr.msg_hdr.msg_namelen;
+        msgs.emplace_back(
+            slot(i).first(std::min<size_t>(hdr.msg_len, msg_size)), addrs[i],
+            (hdr.msg_hdr.msg_flags & MSG_TRUNC) != 0);
+    }
+    return msgs;
+}
+
+bool MsgBatch::push(std::span<const std::byte> data)
+{
+    SockAddrBuf none;
+    none.len = 0;
+    return push(data, none);
+}
+
+bool MsgBatch::push(std::span<const std::byte> data, const SockAddrBuf& addr)
+{
+    if (data.size() > msg_size)
+    {
+        throw util::makeSystemError(EMSGSIZE, "MsgBatch::push");
+    }
+    if (queued == hdrs.size())
+    {
+        return false;
+    }
+    std::copy(data.begin(), data.end(), slot(queued).begin());
+    iovs[queued].iov_len = data.size();
+    addrs[queued] = addr;
+    auto& hdr = hdrs[queued].msg_hdr;
+    hdr.msg_name = addr.len ? static_cast<sockaddr*>(addrs[queued]) : nullptr;
+    hdr.msg_namelen = addr.len;
+    hdr.msg_flags = 0;
+    ++queued;
+    return true;
+}
+
+size_t MsgBatch::send(Fd& fd, SendFlags flags)
+{
+    if (pending() == 0)
+    {
+        return 0;
+    }
+    auto n = fd.sendmmsg(std::span(hdrs).subspan(head, pending()), flags);
+    head += n;
+    if (head == queued)
+    {
+        clear();
+    }
+    return n;
+}
+
+void MsgBatch::clear() noexcept
+{
+    head = 0;
+    queued = 0;
+}
+
+std::span<std::byte> MsgBatch::slot(size_t i) noexcept
+{
+    return std::span(bufs).subspan(i * msg_size, msg_size);
+}
+
+} // namespace fd
+} // namespace stdplus
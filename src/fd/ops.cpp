@@ -1,6 +1,8 @@
 #include <stdplus/exception.hpp>
 #include <stdplus/fd/ops.hpp>
 
+#include <algorithm>
+#include <array>
 #include <format>
 #include <utility>
 
@@ -11,23 +13,20 @@ namespace fd
 namespace detail
 {
 
-template <typename Fun, typename Byte, typename... Args>
-static void opExact(const char* name, Fun&& fun, Fd& fd, std::span<Byte> data,
-                    Args&&... args)
+template <typename Fun>
+static void countExact(const char* name, size_t want, Fun&& fun)
 {
     std::size_t total = 0;
     try
     {
-        while (total < data.size())
+        while (total < want)
         {
-            auto r =
-                (fd.*fun)(data.subspan(total), std::forward<Args>(args)...);
-            if (r.size() == 0)
+            auto r = fun(total);
+            if (r == 0)
             {
-                throw exception::WouldBlock(
-                    std::format("{} missing", name, data.size()));
+                throw exception::WouldBlock(std::format("{} missing", name));
             }
-            total += r.size();
+            total += r;
         }
     }
     catch (const std::system_error&)
@@ -35,12 +34,22 @@ static void opExact(const char* name, Fun&& fun, Fd& fd, std::span<Byte> data,
         if (total != 0)
         {
             throw exception::Incomplete(
-                std::format("{} is {}B/{}B", name, total, data.size()));
+                std::format("{} is {}B/{}B", name, total, want));
         }
         throw;
     }
 }
 
+template <typename Fun, typename Byte, typename... Args>
+static void opExact(const char* name, Fun&& fun, Fd& fd, std::span<Byte> data,
+                    Args&&... args)
+{
+    countExact(name, data.size(), [&](size_t total) {
+        return (fd.*fun)(data.subspan(total), std::forward<Args>(args)...)
+            .size();
+    });
+}
+
 void readExact(Fd& fd, std::span<std::byte> data)
 {
     opExact("readExact", &Fd::read, fd, data);
@@ -61,6 +70,52 @@ void sendExact(Fd& fd, std::span<const std::byte> data, SendFlags flags)
     opExact("sendExact", &Fd::send, fd, data, flags);
 }
 
+void preadExact(Fd& fd, std::span<std::byte> data, off_t offset)
+{
+    countExact("preadExact", data.size(), [&](size_t total) {
+        return fd.pread(data.subspan(total), offset + total).size();
+    });
+}
+
+void pwriteExact(Fd& fd, std::span<const std::byte> data, off_t offset)
+{
+    countExact("pwriteExact", data.size(), [&](size_t total) {
+        return fd.pwrite(data.subspan(total), offset + total).size();
+    });
+}
+
+static std::optional<off_t> advance(std::optional<off_t> offset,
+                                    size_t total)
+{
+    return offset ? std::optional<off_t>(*offset + total) : std::nullopt;
+}
+
+void copyFileRangeExact(Fd& in, std::optional<off_t> offset, Fd& out,
+                        std::optional<off_t> out_offset, size_t len)
+{
+    countExact("copyFileRangeExact", len, [&](size_t total) {
+        return in.copyFileRange(advance(offset, total), out,
+                                advance(out_offset, total), len - total);
+    });
+}
+
+void spliceExact(Fd& in, std::optional<off_t> offset, Fd& out,
+                 std::optional<off_t> out_offset, size_t len,
+                 SpliceFlags flags)
+{
+    countExact("spliceExact", len, [&](size_t total) {
+        return in.splice(advance(offset, total), out,
+                         advance(out_offset, total), len - total, flags);
+    });
+}
+
+void sendfileExact(Fd& in, Fd& out, std::optional<off_t> offset, size_t len)
+{
+    countExact("sendfileExact", len, [&](size_t total) {
+        return in.sendfile(out, advance(offset, total), len - total);
+    });
+}
+
 void sendtoExact(Fd& fd, std::span<const std::byte> data, SendFlags flags,
                  std::span<const std::byte> addr)
 {
@@ -130,14 +185,69 @@ std::span<const std::byte> sendAligned(
     return opAligned("sendAligned", &Fd::send, fd, align, data, flags);
 }
 
+template <typename Fun, typename Byte, typename... Args>
+static IOResult<std::span<Byte>> tryOpAligned(Fun&& fun, Fd& fd, size_t align,
+                                              std::span<Byte> data,
+                                              Args&&... args)
+{
+    std::size_t total = 0;
+    do
+    {
+        auto r = (fd.*fun)(data.subspan(total), std::forward<Args>(args)...);
+        // Only a partial element keeps us going, losing it is the same
+        // failure opAligned() reports as exception::Incomplete
+        if (total != 0 && (!r || r->empty()))
+        {
+            return std::unexpected(IOError{EILSEQ});
+        }
+        if (!r)
+        {
+            return std::unexpected(r.error());
+        }
+        total += r->size();
+    } while (total % align != 0);
+    return std::span<Byte>(data.data(), total);
+}
+
+IOResult<std::span<std::byte>> tryReadAligned(Fd& fd, size_t align,
+                                              std::span<std::byte> buf)
+{
+    return tryOpAligned(&Fd::tryRead, fd, align, buf);
+}
+
+IOResult<std::span<std::byte>> tryRecvAligned(
+    Fd& fd, size_t align, std::span<std::byte> buf, RecvFlags flags)
+{
+    return tryOpAligned(&Fd::tryRecv, fd, align, buf, flags);
+}
+
+IOResult<std::span<const std::byte>> tryWriteAligned(
+    Fd& fd, size_t align, std::span<const std::byte> data)
+{
+    return tryOpAligned(&Fd::tryWrite, fd, align, data);
+}
+
+IOResult<std::span<const std::byte>> trySendAligned(
+    Fd& fd, size_t align, std::span<const std::byte> data, SendFlags flags)
+{
+    return tryOpAligned(&Fd::trySend, fd, align, data, flags);
+}
+
 constexpr std::size_t maxStrideB = 65536;
 
-void readAll(Fd& fd, function_view<std::span<std::byte>(size_t req)> resize)
+void readAll(Fd& fd, function_view<std::span<std::byte>(size_t req)> resize,
+             size_t initB)
 {
-    std::size_t strideB = 256;
+    std::size_t strideB = std::max<size_t>(initB, 1);
     std::size_t totalB = 0;
+    std::span<std::byte> buf;
     auto doRead = [&]() {
-        auto buf = resize(totalB + strideB);
+        // Only a full buffer grows, doubling it keeps the number of reads
+        // and reallocations logarithmic in the size of the file
+        if (totalB == buf.size())
+        {
+            buf = resize(totalB + std::max(strideB, totalB));
+        }
         auto r = fd.read(buf.subspan(totalB));
         if (r.size() == 0)
         {
@@ -146,7 +256,7 @@ void readAll(Fd& fd, function_view<std::span<std::byte>(size_t req)> resize)
         totalB += r.size();
     };
     auto validateSize = [&]() {
-        auto buf = resize(totalB);
+        buf = resize(totalB);
         if (totalB != buf.size())
         {
             throw exception::Incomplete(
@@ -155,14 +265,6 @@ void readAll(Fd& fd, function_view<std::span<std::byte>(size_t req)> resize)
     };
     try
     {
-        while (strideB < maxStrideB)
-        {
-            doRead();
-            if (totalB >= strideB)
-            {
-                strideB = strideB << 1;
-            }
-        }
         while (true)
         {
             doRead();
@@ -234,5 +336,53 @@ void verifyExact(size_t expected, size_t actual)
 }
 
 } // namespace detail
+
+template <typename Fun, typename Byte>
+static void opvExact(const char* name, Fun&& fun, Fd& fd,
+                     std::span<const std::span<Byte>> bufs)
+{
+    // Bounded so the iovecs can live on the stack, the kernel caps a single
+    // call at IOV_MAX anyway
+    constexpr size_t maxIov = 64;
+    std::array<iovec, maxIov> iov;
+    size_t want = 0;
+    for (const auto& buf : bufs)
+    {
+        want += buf.size();
+    }
+    size_t idx = 0, off = 0;
+    detail::countExact(name, want, [&](size_t) {
+        size_t n = 0;
+        for (size_t i = idx, o = off; i < bufs.size() && n < maxIov; ++i)
+        {
+            if (bufs[i].size() > o)
+            {
+                iov[n].iov_base = const_cast<std::byte*>(bufs[i].data()) + o;
+                iov[n++].iov_len = bufs[i].size() - o;
+            }
+            o = 0;
+        }
+        auto r = (fd.*fun)(std::span<const iovec>(iov.data(), n));
+        // Advance past everything consumed, possibly ending mid buffer
+        auto left = r + off;
+        while (idx < bufs.size() && left >= bufs[idx].size())
+        {
+            left -= bufs[idx++].size();
+        }
+        off = left;
+        return r;
+    });
+}
+
+void readvExact(Fd& fd, std::span<const std::span<std::byte>> bufs)
+{
+    opvExact("readvExact", &Fd::readv, fd, bufs);
+}
+
+void writevExact(Fd& fd, std::span<const std::span<const std::byte>> bufs)
+{
+    opvExact("writevExact", &Fd::writev, fd, bufs);
+}
+
 } // namespace fd
 } // namespace stdplus
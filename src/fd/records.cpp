@@ -0,0 +1,196 @@
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <stdplus/fd/records.hpp>
+#include <stdplus/util/cexec.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace stdplus
+{
+namespace fd
+{
+
+static size_t pageSize() noexcept
+{
+    static const size_t size = sysconf(_SC_PAGESIZE);
+    return size;
+}
+
+MMapRecords::MMapRecords(Fd& fd, size_t window, std::string_view delim) :
+    fd(fd), window(std::max(window, pageSize())), delim(delim)
+{
+    if (delim.empty())
+    {
+        throw util::makeSystemError(EINVAL, "MMapRecords delimiter");
+    }
+    auto cur = fd.lseek(0, Whence::Cur);
+    size = fd.lseek(0, Whence::End);
+    fd.lseek(cur, Whence::Set);
+}
+
+std::optional<std::string_view> MMapRecords::next()
+{
+    if (done)
+    {
+        return std::nullopt;
+    }
+    while (true)
+    {
+        if (map)
+        {
+            auto data = map->get();
+            std::string_view view(
+                reinterpret_cast<const char*>(data.data()) + (pos - map_off),
+                map_off + data.size() - pos);
+            if (auto i = view.find(delim); i != view.npos)
+            {
+                pos += i + delim.size();
+                return view.substr(0, i);
+            }
+            if (map_off + data.size() == size)
+            {
+                pos = size;
+                done = true;
+                return view;
+            }
+        }
+        else if (pos == size)
+        {
+            // Empty files can't be mapped but still have an empty record
+            done = true;
+            return std::string_view();
+        }
+        // The record continues past the window, so move the window to its
+        // start. A record already at the start of the window needs it grown.
+        auto len = window;
+        if (map && pos - pos % pageSize() == map_off)
+        {
+            len = map->get().size() * 2;
+        }
+        remap(len);
+    }
+}
+
+void MMapRecords::remap(size_t len)
+{
+    map.reset();
+    map_off = pos - pos % pageSize();
+    map.emplace(fd, std::min(len, size - map_off),
+                ProtFlags().set(ProtFlag::Read),
+                MMapFlags{MMapAccess::Private}, map_off);
+    auto data = map->get();
+    // Only advice, the mapping works the same if the kernel ignores it
+    ::madvise(data.data(), data.size(), MADV_SEQUENTIAL);
+}
+
+size_t parallelRecords(
+    Fd& fd, function_view<void(size_t chunk, std::string_view record)> fn,
+    size_t threads, std::string_view delim, size_t chunk_size)
+{
+    if (delim.empty())
+    {
+        throw util::makeSystemError(EINVAL, "parallelRecords delimiter");
+    }
+    auto cur = fd.lseek(0, Whence::Cur);
+    auto size = fd.lseek(0, Whence::End);
+    fd.lseek(cur, Whence::Set);
+    if (size == 0)
+    {
+        fn(0, {});
+        return 1;
+    }
+    MMap map(fd, size, ProtFlags().set(ProtFlag::Read),
+             MMapFlags{MMapAccess::Private}, 0);
+    auto mdata = map.get();
+    std::string_view data(reinterpret_cast<const char*>(mdata.data()),
+                          mdata.size());
+
+    // Finding the boundaries is a single search per chunk, so it is cheap
+    // enough to do up front
+    std::vector<size_t> bounds = {0};
+    chunk_size = std::max<size_t>(chunk_size, 1);
+    while (size - bounds.back() > chunk_size)
+    {
+        // Back up in case the delimiter straddles the nominal boundary
+        auto i = data.find(delim, bounds.back() + chunk_size -
+                                      std::min(chunk_size, delim.size() - 1));
+        if (i == data.npos)
+        {
+            break;
+        }
+        bounds.push_back(i + delim.size());
+    }
+    // If the last boundary is the end of the file this adds an empty chunk,
+    // holding the empty record after the final delimiter
+    bounds.push_back(size);
+    auto chunks = bounds.size() - 1;
+    // Only advice, every thread reads its chunks front to back
+    ::madvise(mdata.data(), mdata.size(), MADV_SEQUENTIAL);
+
+    std::atomic<size_t> next = 0;
+    std::mutex lock;
+    std::exception_ptr error;
+    auto worker = [&]() {
+        size_t c;
+        while ((c = next++) < chunks)
+        {
+            auto chunk = data.substr(bounds[c], bounds[c + 1] - bounds[c]);
+            try
+            {
+                while (true)
+                {
+                    auto i = chunk.find(delim);
+                    if (i == chunk.npos)
+                    {
+                        // Only the end of the file has a record without a
+                        // delimiter, every other chunk ends in one
+                        if (c + 1 == chunks)
+                        {
+                            fn(c, chunk);
+                        }
+                        break;
+                    }
+                    fn(c, chunk.substr(0, i));
+                    chunk.remove_prefix(i + delim.size());
+                }
+            }
+            catch (...)
+            {
+                std::lock_guard lk(lock);
+                if (!error)
+                {
+                    error = std::current_exception();
+                }
+                next = chunks;
+            }
+        }
+    };
+
+    if (threads == 0)
+    {
+        threads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    threads = std::min(threads, chunks);
+    {
+        std::vector<std::jthread> pool;
+        for (size_t i = 1; i < threads; ++i)
+        {
+            pool.emplace_back(worker);
+        }
+        worker();
+    }
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+    return chunks;
+}
+
+} // namespace fd
+} // namespace stdplus
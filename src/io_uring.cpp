@@ -1,12 +1,21 @@
 #include <liburing.h>
+#include <sys/epoll.h>
 #include <sys/eventfd.h>
+#include <sys/resource.h>
 
+#include <stdplus/exception.hpp>
 #include <stdplus/fd/managed.hpp>
 #include <stdplus/fd/ops.hpp>
 #include <stdplus/io_uring.hpp>
+#include <stdplus/print.hpp>
 #include <stdplus/util/cexec.hpp>
 
 #include <algorithm>
+#include <array>
+#include <bit>
+#include <format>
+#include <limits>
+#include <utility>
 
 namespace stdplus
 {
@@ -31,6 +40,58 @@ IoUring::IoUring(size_t queue_size, io_uring_params& params)
               "io_uring_queue_init_params");
 }
 
+IoUring::Setup::Setup(size_t queue_size) noexcept : queue_size(queue_size) {}
+
+IoUring::Setup& IoUring::Setup::set(SetupFlag flag) noexcept
+{
+    params.flags |= static_cast<unsigned>(flag);
+    return *this;
+}
+
+IoUring::Setup& IoUring::Setup::set(SetupFlags flags) noexcept
+{
+    params.flags |= static_cast<unsigned>(flags);
+    return *this;
+}
+
+IoUring::Setup& IoUring::Setup::cqSize(unsigned entries) noexcept
+{
+    params.flags |= IORING_SETUP_CQSIZE;
+    params.cq_entries = entries;
+    return *this;
+}
+
+IoUring::Setup& IoUring::Setup::sqPoll(std::chrono::milliseconds idle,
+                                       std::optional<unsigned> cpu) noexcept
+{
+    set(SetupFlag::SQPoll);
+    params.sq_thread_idle = idle.count();
+    if (cpu)
+    {
+        set(SetupFlag::SQAff);
+        params.sq_thread_cpu = *cpu;
+    }
+    return *this;
+}
+
+IoUring::Setup& IoUring::Setup::coopTaskrun() noexcept
+{
+    return set(SetupFlags(SetupFlag::CoopTaskrun).set(SetupFlag::TaskrunFlag));
+}
+
+IoUring::Setup& IoUring::Setup::deferTaskrun() noexcept
+{
+    return set(
+        SetupFlags(SetupFlag::SingleIssuer).set(SetupFlag::DeferTaskrun));
+}
+
+IoUring::IoUring(const Setup& setup)
+{
+    auto params = setup.getParams();
+    CHECK_RET(io_uring_queue_init_params(setup.getQueueSize(), &ring, &params),
+              "io_uring_queue_init_params");
+}
+
 IoUring::~IoUring()
 {
     io_uring_queue_exit(&ring);
@@ -38,7 +99,10 @@ IoUring::~IoUring()
     cqe.res = -ECANCELED;
     for (auto h : handlers)
     {
-        h->handleCQE(cqe);
+        for (auto n = std::exchange(h->refs, 0); n > 0; --n)
+        {
+            h->handleCQE(cqe);
+        }
     }
 }
 
@@ -48,6 +112,7 @@ IoUring::FileHandle::FileHandle(unsigned slot, IoUring& ring) :
 
 void IoUring::FileHandle::drop(unsigned&& slot, IoUring*& ring)
 {
+    ring->filesFree.push_back(slot);
     ring->updateFile(slot, -1);
 }
 
@@ -56,36 +121,307 @@ void IoUring::reserveFiles(size_t num)
     auto new_size = std::max<size_t>(7, num + filesAllocated);
     if (files.size() < new_size)
     {
-        io_uring_unregister_files(&ring);
-        files.resize(new_size, -1);
-        CHECK_RET(io_uring_register_files(&ring, files.data(), files.size()),
-                  "io_uring_register_files");
+        growFiles(new_size);
     }
 }
 
 [[nodiscard]] IoUring::FileHandle IoUring::registerFile(int fd)
 {
-    unsigned slot = 0;
-    for (; slot < files.size(); slot++)
+    if (filesFree.empty())
+    {
+        growFiles(std::max<size_t>(7, files.size() * 2 + 1));
+    }
+    auto slot = filesFree.back();
+    updateFile(slot, fd);
+    filesFree.pop_back();
+    return FileHandle(slot, *this);
+}
+
+IoUring::BufferHandle::BufferHandle(unsigned slot, std::span<std::byte> buf,
+                                    IoUring& ring) : buf(buf), slot(slot, &ring)
+{}
+
+void IoUring::BufferHandle::drop(unsigned&& slot, IoUring*& ring)
+{
+    ring->bufFree.push_back(slot);
+}
+
+void IoUring::registerBuffers(size_t num, size_t size)
+{
+    if (bufFree.size() != bufNum)
+    {
+        throw util::makeSystemError(EBUSY, "registerBuffers");
+    }
+    if (bufSlab)
+    {
+        io_uring_unregister_buffers(&ring);
+        bufSlab.reset();
+        bufFree.clear();
+        bufNum = 0;
+    }
+
+    auto slab = std::make_unique_for_overwrite<std::byte[]>(num * size);
+    std::vector<iovec> iovs(num);
+    for (size_t i = 0; i < num; ++i)
+    {
+        iovs[i].iov_base = slab.get() + i * size;
+        iovs[i].iov_len = size;
+    }
+    CHECK_RET(io_uring_register_buffers(&ring, iovs.data(), iovs.size()),
+              "io_uring_register_buffers");
+
+    bufSlab = std::move(slab);
+    bufSize = size;
+    bufNum = num;
+    bufFree.resize(num);
+    for (size_t i = 0; i < num; ++i)
+    {
+        bufFree[i] = num - i - 1;
+    }
+}
+
+[[nodiscard]] IoUring::BufferHandle IoUring::getBuffer()
+{
+    if (bufFree.empty())
+    {
+        throw util::makeSystemError(ENOBUFS, "getBuffer");
+    }
+    auto slot = bufFree.back();
+    bufFree.pop_back();
+    return BufferHandle(
+        slot, std::span(bufSlab.get() + slot * bufSize, bufSize), *this);
+}
+
+IoUring::BufferRing::BufferRing(IoUring& ring, uint16_t group,
+                                unsigned entries, size_t size) :
+    ring(ring),
+    slab(std::make_unique_for_overwrite<std::byte[]>(entries * size)),
+    group(group), entries(entries), size(size)
+{
+    int ret;
+    br = io_uring_setup_buf_ring(&ring.ring, entries, group, 0, &ret);
+    if (br == nullptr)
+    {
+        throw util::makeSystemError(-ret, "io_uring_setup_buf_ring");
+    }
+    auto mask = io_uring_buf_ring_mask(entries);
+    for (unsigned i = 0; i < entries; ++i)
+    {
+        io_uring_buf_ring_add(br, slab.get() + i * size, size, i, mask, i);
+    }
+    io_uring_buf_ring_advance(br, entries);
+}
+
+IoUring::BufferRing::~BufferRing()
+{
+    io_uring_free_buf_ring(&ring.ring, br, entries, group);
+}
+
+std::span<std::byte>
+    IoUring::BufferRing::getData(const io_uring_cqe& cqe) const noexcept
+{
+    if (!(cqe.flags & IORING_CQE_F_BUFFER) || cqe.res <= 0)
+    {
+        return {};
+    }
+    auto id = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+    return {slab.get() + id * size, static_cast<size_t>(cqe.res)};
+}
+
+void IoUring::BufferRing::recycle(const io_uring_cqe& cqe) noexcept
+{
+    if (!(cqe.flags & IORING_CQE_F_BUFFER))
+    {
+        return;
+    }
+    auto id = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+    io_uring_buf_ring_add(br, slab.get() + id * size, size, id,
+                          io_uring_buf_ring_mask(entries), 0);
+    io_uring_buf_ring_advance(br, 1);
+}
+
+void IoUring::BufferHandler::handleCQE(io_uring_cqe& cqe) noexcept
+{
+    // The handler may be destroyed by its final CQE, keep our own reference
+    // to the buffers for recycling.
+    auto& b = bufs;
+    handleBuffer(cqe, b.getData(cqe));
+    b.recycle(cqe);
+}
+
+void IoUring::SendZCHandler::handleCQE(io_uring_cqe& cqe) noexcept
+{
+    // Cancellation CQEs from the ring teardown have no flags, they release
+    // the data once every send has its result
+    if ((cqe.flags & IORING_CQE_F_NOTIF) || sending == 0)
     {
-        if (files[slot] == -1)
+        handleRelease(cqe.flags & IORING_CQE_F_NOTIF &&
+                      cqe.res & IORING_NOTIF_USAGE_ZC_COPIED);
+        return;
+    }
+    sending--;
+    bool more = cqe.flags & IORING_CQE_F_MORE;
+    handleSent(cqe);
+    // Failed sends never reference the data
+    if (!more)
+    {
+        handleRelease(false);
+    }
+}
+
+IoUring::Chain::Link& IoUring::Chain::nextLink()
+{
+    if (linksUsed == links.size())
+    {
+        links.emplace_back(*this);
+    }
+    return links[linksUsed++];
+}
+
+void IoUring::Chain::linkLast(size_t needed)
+{
+    if (last == nullptr)
+    {
+        return;
+    }
+    // The chain is broken if the queue is submitted before it is complete
+    if (io_uring_sq_space_left(&ring.ring) < needed + (lastDeadline ? 1 : 0))
+    {
+        // The requests added so far are already in the queue, send them as
+        // a shorter chain so their completions still reach handleChain()
+        if (needed > 0 &&
+            io_uring_sq_space_left(&ring.ring) >= (lastDeadline ? 1 : 0))
         {
-            updateFile(slot, fd);
-            return FileHandle(slot, *this);
+            linkLast(0);
         }
+        last->flags &= ~IOSQE_IO_LINK;
+        last = nullptr;
+        lastDeadline.reset();
+        queued = true;
+        throw util::makeSystemError(EBUSY, "Chain::add");
+    }
+    if (needed > 0 || lastDeadline)
+    {
+        last->flags |= IOSQE_IO_LINK;
     }
+    if (lastDeadline)
+    {
+        auto& link = nextLink();
+        link.op = res.size() - 1;
+        link.deadline = true;
+        link.ts = *lastDeadline;
+        last = &ring.getSQE();
+        io_uring_prep_link_timeout(last, &link.ts, 0);
+        ring.setHandler(*last, &link);
+        outstanding++;
+        lastDeadline.reset();
+        if (needed > 0)
+        {
+            last->flags |= IOSQE_IO_LINK;
+        }
+    }
+}
 
-    io_uring_unregister_files(&ring);
-    files.resize(std::max<size_t>(7, files.size() * 2 + 1), -1);
-    setFile(slot, fd);
-    CHECK_RET(io_uring_register_files(&ring, files.data(), files.size()),
-              "io_uring_register_files");
-    return FileHandle(slot, *this);
+io_uring_sqe& IoUring::Chain::add()
+{
+    if (queued)
+    {
+        throw util::makeSystemError(EBUSY, "Chain::add");
+    }
+    if (linksUsed == 0)
+    {
+        res.clear();
+    }
+    linkLast(1);
+    auto& sqe = ring.getSQE();
+    auto& link = nextLink();
+    link.op = res.size();
+    link.deadline = false;
+    res.push_back(0);
+    ring.setHandler(sqe, &link);
+    outstanding++;
+    last = &sqe;
+    return sqe;
+}
+
+io_uring_sqe& IoUring::Chain::add(std::chrono::nanoseconds deadline)
+{
+    auto& sqe = add();
+    lastDeadline = chronoToKTS(deadline);
+    return sqe;
+}
+
+void IoUring::Chain::queue()
+{
+    if (queued)
+    {
+        throw util::makeSystemError(EBUSY, "Chain::queue");
+    }
+    linkLast(0);
+    last = nullptr;
+    queued = true;
+    if (outstanding == 0)
+    {
+        complete();
+    }
+}
+
+void IoUring::Chain::complete() noexcept
+{
+    // Reset before calling the handler so it can build the next chain, the
+    // results are cleared once it does.
+    linksUsed = 0;
+    queued = false;
+    handleChain(res);
+}
+
+void IoUring::Chain::Link::handleCQE(io_uring_cqe& cqe) noexcept
+{
+    auto& r = chain.res[op];
+    if (deadline)
+    {
+        // The request reports -ECANCELED when its deadline fires
+        if (cqe.res == -ETIME)
+        {
+            r = -ETIME;
+        }
+    }
+    else if (cqe.res != -ECANCELED || r != -ETIME)
+    {
+        r = cqe.res;
+    }
+    if (--chain.outstanding == 0 && chain.queued)
+    {
+        chain.complete();
+    }
 }
 
 io_uring_sqe& IoUring::getSQE()
 {
-    return *CHECK_ERRNO(io_uring_get_sqe(&ring), "io_uring_get_sqe");
+    auto sqep = io_uring_get_sqe(&ring);
+    if (sqep == nullptr && sq_full != SQFull::Throw)
+    {
+        submit();
+        // Handlers queueing requests are called with CQEs the outer
+        // process() has yet to advance past, reaping them here would run
+        // them twice
+        if (sq_full == SQFull::SubmitProcess && !in_process)
+        {
+            process();
+        }
+        // An SQPOLL thread consumes the queue asynchronously
+        CHECK_RET(io_uring_sqring_wait(&ring), "io_uring_sqring_wait");
+        sqep = io_uring_get_sqe(&ring);
+    }
+    if (sqep == nullptr)
+    {
+        throw util::makeSystemError(EBUSY, "io_uring_get_sqe");
+    }
+    auto& sqe = *sqep;
+    // liburing does not reset the user data of recycled SQEs, make sure we
+    // never mistake a stale value for a registered handler.
+    io_uring_sqe_set_data(&sqe, nullptr);
+    return sqe;
 }
 
 void IoUring::setHandler(io_uring_sqe& sqe, CQEHandler* h) noexcept
@@ -95,16 +431,57 @@ void IoUring::setHandler(io_uring_sqe& sqe, CQEHandler* h) noexcept
     {
         return;
     }
+    if (oldh != nullptr && stats)
+    {
+        stats->replaced++;
+    }
     io_uring_cqe cqe{};
     cqe.res = -ECANCELED;
     dropHandler(oldh, cqe);
-    if (h != nullptr)
+    if (h != nullptr && h->refs++ == 0)
     {
+        h->slot = handlers.size();
         handlers.push_back(h);
     }
     io_uring_sqe_set_data(&sqe, h);
 }
 
+void IoUring::recvMultishot(int fd, BufferHandler& h, fd::RecvFlags flags)
+{
+    auto& sqe = getSQE();
+    io_uring_prep_recv_multishot(&sqe, fd, nullptr, 0,
+                                 static_cast<int>(flags));
+    sqe.flags |= IOSQE_BUFFER_SELECT;
+    sqe.buf_group = h.bufs.getGroup();
+    setHandler(sqe, &h);
+}
+
+void IoUring::acceptMultishot(int fd, CQEHandler& h)
+{
+    auto& sqe = getSQE();
+    io_uring_prep_multishot_accept(&sqe, fd, nullptr, nullptr, 0);
+    setHandler(sqe, &h);
+}
+
+void IoUring::sendZC(int fd, std::span<const std::byte> data,
+                     SendZCHandler& h, fd::SendFlags flags, bool report)
+{
+    auto& sqe = getSQE();
+    // Older kernels reject the flag, so only pass it when asked for
+    io_uring_prep_send_zc(&sqe, fd, data.data(), data.size(),
+                          static_cast<int>(flags),
+                          report ? IORING_SEND_ZC_REPORT_USAGE : 0);
+    setHandler(sqe, &h);
+    h.sending++;
+}
+
+void IoUring::msgRing(IoUring& target, int32_t data)
+{
+    // The target ring can never be mistaken for one of its handlers
+    io_uring_prep_msg_ring(&getSQE(), target.ring.ring_fd, data,
+                           reinterpret_cast<uintptr_t>(&target), 0);
+}
+
 void IoUring::cancelHandler(CQEHandler& h)
 {
     io_uring_prep_cancel(&getSQE(), &h, 0);
@@ -113,18 +490,185 @@ void IoUring::cancelHandler(CQEHandler& h)
 
 void IoUring::submit()
 {
+    countSQEs();
     CHECK_RET(io_uring_submit(&ring), "io_uring_submit");
 }
 
-void IoUring::process() noexcept
+void IoUring::process()
 {
-    io_uring_cqe* cqe;
-    while (io_uring_peek_cqe(&ring, &cqe) == 0)
+    process(std::numeric_limits<size_t>::max());
+}
+
+size_t IoUring::process(size_t max)
+{
+    // Deferred completions only need a syscall if nothing is ready yet,
+    // waiting for CQEs already ran the task work
+    if ((ring.flags & IORING_SETUP_DEFER_TASKRUN) &&
+        io_uring_cq_ready(&ring) == 0)
+    {
+        auto ret = io_uring_get_events(&ring);
+        if (ret != -EINTR && ret != -EAGAIN && ret != -EBUSY)
+        {
+            CHECK_RET(ret, "io_uring_get_events");
+        }
+    }
+    // Reap CQEs in batches so the shared CQ head is only advanced once per
+    // batch instead of once per CQE.
+    std::array<io_uring_cqe*, 32> cqes;
+    size_t total = 0;
+    // Handlers are noexcept, so this is always restored before returning
+    auto outer = std::exchange(in_process, true);
+    while (total < max)
+    {
+        // Internal CQEs are reaped along with the rest but don't count
+        // against the budget
+        auto n = io_uring_peek_batch_cqe(
+            &ring, cqes.data(), std::min<size_t>(cqes.size(), max - total));
+        if (n == 0)
+        {
+            break;
+        }
+        std::chrono::steady_clock::time_point now;
+        if (stats)
+        {
+            now = std::chrono::steady_clock::now();
+            stats->overflows += io_uring_cq_has_overflow(&ring) ? 1 : 0;
+        }
+        for (unsigned i = 0; i < n; ++i)
+        {
+            // liburing may emulate wait timeouts with internal requests
+            if (cqes[i]->user_data == LIBURING_UDATA_TIMEOUT)
+            {
+                continue;
+            }
+            if (cqes[i]->user_data == reinterpret_cast<uintptr_t>(this))
+            {
+                if (msg_handler != nullptr)
+                {
+                    msg_handler->handleCQE(*cqes[i]);
+                    total++;
+                }
+                continue;
+            }
+            auto h = reinterpret_cast<CQEHandler*>(cqes[i]->user_data);
+            if (stats)
+            {
+                countCQE(h, *cqes[i], now);
+            }
+            if (h != nullptr)
+            {
+                dropHandler(h, *cqes[i]);
+                total++;
+            }
+        }
+        io_uring_cq_advance(&ring, n);
+    }
+    in_process = outer;
+    return total;
+}
+
+void IoUring::enableStats(bool enable)
+{
+    if (enable)
+    {
+        stats = std::make_unique<Stats>();
+    }
+    else
+    {
+        stats.reset();
+    }
+}
+
+const IoUring::Stats* IoUring::getStats() noexcept
+{
+    if (stats)
+    {
+        stats->dropped = *ring.cq.koverflow;
+    }
+    return stats.get();
+}
+
+void IoUring::Stats::dump(std::FILE* stream) const
+{
+    println(stream,
+            "submitted={} completed={} inflight={} cqes={} unhandled={} "
+            "replaced={} overflows={} dropped={}",
+            submitted, completed, inflight(), cqes, unhandled, replaced,
+            overflows, dropped);
+    for (size_t i = 0; i < ops.size(); ++i)
+    {
+        if (ops[i] != 0)
+        {
+            println(stream, "  op {}: {}", i, ops[i]);
+        }
+    }
+    for (size_t i = 0; i < latency.size(); ++i)
+    {
+        if (latency[i] == 0)
+        {
+            continue;
+        }
+        if (i + 1 == latency.size())
+        {
+            println(stream, "  latency >= {}us: {}", 1u << (i - 1),
+                    latency[i]);
+        }
+        else
+        {
+            println(stream, "  latency < {}us: {}", 1u << i, latency[i]);
+        }
+    }
+}
+
+void IoUring::countSQEs() noexcept
+{
+    if (!stats)
+    {
+        return;
+    }
+    // Only SQEs which haven't been flushed to the kernel yet are visible
+    auto now = std::chrono::steady_clock::now();
+    auto mask = *ring.sq.kring_mask;
+    for (auto i = ring.sq.sqe_head; i != ring.sq.sqe_tail; ++i)
+    {
+        const auto& sqe = ring.sq.sqes[i & mask];
+        if (sqe.opcode < stats->ops.size())
+        {
+            stats->ops[sqe.opcode]++;
+        }
+        stats->submitted++;
+        auto h = reinterpret_cast<CQEHandler*>(sqe.user_data);
+        if (h != nullptr && sqe.user_data != LIBURING_UDATA_TIMEOUT)
+        {
+            h->submitted = now;
+        }
+    }
+}
+
+void IoUring::countCQE(CQEHandler* h, const io_uring_cqe& cqe,
+                       std::chrono::steady_clock::time_point now) noexcept
+{
+    stats->cqes++;
+    if (h == nullptr)
+    {
+        stats->unhandled++;
+    }
+    if (cqe.flags & IORING_CQE_F_MORE)
     {
-        auto h = reinterpret_cast<CQEHandler*>(cqe->user_data);
-        dropHandler(h, *cqe);
-        io_uring_cqe_seen(&ring, cqe);
+        return;
+    }
+    stats->completed++;
+    // Requests submitted before stats were enabled have no timestamp
+    if (h == nullptr || h->submitted == std::chrono::steady_clock::time_point{})
+    {
+        return;
     }
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+                  now - h->submitted)
+                  .count();
+    auto bucket = std::bit_width(static_cast<uint64_t>(std::max<int64_t>(
+        us, 0)));
+    stats->latency[std::min<size_t>(bucket, stats->latency.size() - 1)]++;
 }
 
 void IoUring::wait()
@@ -141,6 +685,360 @@ void IoUring::wait(std::chrono::nanoseconds timeout)
               "io_uring_wait_cqe_timeout");
 }
 
+static int checkCQE(const io_uring_cqe& cqe, const char* name)
+{
+    if (cqe.res < 0)
+    {
+        throw util::makeSystemError(-cqe.res, name);
+    }
+    return cqe.res;
+}
+
+template <typename Byte>
+static std::span<Byte> cqeSpan(const io_uring_cqe& cqe, std::span<Byte> buf,
+                               const char* name)
+{
+    auto r = checkCQE(cqe, name);
+    if (r == 0 && buf.size() > 0)
+    {
+        throw exception::Eof(name);
+    }
+    return buf.subspan(0, r);
+}
+
+void IoUring::ReadOp::prep(io_uring_sqe& sqe) noexcept
+{
+    io_uring_prep_read(&sqe, fd, buf.data(), buf.size(), offset);
+}
+
+std::span<std::byte> IoUring::ReadOp::finish(const io_uring_cqe& cqe) const
+{
+    return cqeSpan(cqe, buf, "io_uring read");
+}
+
+void IoUring::WriteOp::prep(io_uring_sqe& sqe) noexcept
+{
+    io_uring_prep_write(&sqe, fd, data.data(), data.size(), offset);
+}
+
+std::span<const std::byte>
+    IoUring::WriteOp::finish(const io_uring_cqe& cqe) const
+{
+    return cqeSpan(cqe, data, "io_uring write");
+}
+
+void IoUring::AcceptOp::prep(io_uring_sqe& sqe) noexcept
+{
+    if (addr == nullptr)
+    {
+        io_uring_prep_accept(&sqe, fd, nullptr, nullptr, 0);
+        return;
+    }
+    len = addr->maxLen;
+    io_uring_prep_accept(&sqe, fd, reinterpret_cast<sockaddr*>(addr), &len, 0);
+}
+
+DupableFd IoUring::AcceptOp::finish(const io_uring_cqe& cqe)
+{
+    auto fd = checkCQE(cqe, "io_uring accept");
+    if (addr != nullptr)
+    {
+        addr->len = len;
+    }
+    return DupableFd(std::move(fd));
+}
+
+void IoUring::ReadFixedOp::prep(io_uring_sqe& sqe) noexcept
+{
+    io_uring_prep_read_fixed(&sqe, fd, buf.data(), buf.size(), offset, index);
+}
+
+std::span<std::byte> IoUring::ReadFixedOp::finish(const io_uring_cqe& cqe) const
+{
+    return cqeSpan(cqe, buf, "io_uring read_fixed");
+}
+
+void IoUring::WriteFixedOp::prep(io_uring_sqe& sqe) noexcept
+{
+    io_uring_prep_write_fixed(&sqe, fd, data.data(), data.size(), offset,
+                              index);
+}
+
+std::span<const std::byte>
+    IoUring::WriteFixedOp::finish(const io_uring_cqe& cqe) const
+{
+    return cqeSpan(cqe, data, "io_uring write_fixed");
+}
+
+void IoUring::TimeoutOp::prep(io_uring_sqe& sqe) noexcept
+{
+    io_uring_prep_timeout(&sqe, &ts, 0, 0);
+}
+
+void IoUring::TimeoutOp::finish(const io_uring_cqe& cqe) const
+{
+    if (cqe.res != -ETIME)
+    {
+        checkCQE(cqe, "io_uring timeout");
+    }
+}
+
+/** @brief Advances the file offset, unless using the current position */
+static uint64_t advance(uint64_t offset, size_t done)
+{
+    return offset == static_cast<uint64_t>(-1) ? offset : offset + done;
+}
+
+void IoUring::ReadExactOp::prep(io_uring_sqe& sqe) noexcept
+{
+    auto rest = buf.subspan(done);
+    io_uring_prep_read(&sqe, fd, rest.data(), rest.size(),
+                       advance(offset, done));
+}
+
+bool IoUring::ReadExactOp::resubmit(const io_uring_cqe& cqe) noexcept
+{
+    if (cqe.res <= 0)
+    {
+        return false;
+    }
+    done += cqe.res;
+    return done < buf.size();
+}
+
+std::span<std::byte> IoUring::ReadExactOp::finish(const io_uring_cqe& cqe) const
+{
+    if (done < buf.size())
+    {
+        if (done != 0)
+        {
+            throw exception::Incomplete(std::format(
+                "io_uring readExact is {}B/{}B", done, buf.size()));
+        }
+        checkCQE(cqe, "io_uring readExact");
+        throw exception::Eof("io_uring readExact");
+    }
+    return buf;
+}
+
+void IoUring::WriteExactOp::prep(io_uring_sqe& sqe) noexcept
+{
+    auto rest = data.subspan(done);
+    io_uring_prep_write(&sqe, fd, rest.data(), rest.size(),
+                        advance(offset, done));
+}
+
+bool IoUring::WriteExactOp::resubmit(const io_uring_cqe& cqe) noexcept
+{
+    if (cqe.res <= 0)
+    {
+        return false;
+    }
+    done += cqe.res;
+    return done < data.size();
+}
+
+std::span<const std::byte>
+    IoUring::WriteExactOp::finish(const io_uring_cqe& cqe) const
+{
+    if (done < data.size())
+    {
+        if (done != 0)
+        {
+            throw exception::Incomplete(std::format(
+                "io_uring writeExact is {}B/{}B", done, data.size()));
+        }
+        checkCQE(cqe, "io_uring writeExact");
+        // Nothing is non-blocking here, retrying would never make progress
+        throw exception::Incomplete(
+            std::format("io_uring writeExact is 0B/{}B", data.size()));
+    }
+    return data;
+}
+
+void IoUring::ReadAllBase::prep(io_uring_sqe& sqe,
+                                std::span<std::byte> buf) noexcept
+{
+    auto rest = buf.subspan(done);
+    io_uring_prep_read(&sqe, fd, rest.data(), rest.size(),
+                       advance(offset, done));
+}
+
+bool IoUring::ReadAllBase::resubmit(const io_uring_cqe& cqe) noexcept
+{
+    // Grow the reads geometrically while they are filled completely
+    constexpr size_t maxStride = 65536;
+    if (cqe.res <= 0)
+    {
+        return false;
+    }
+    done += cqe.res;
+    if (done >= stride && stride < maxStride)
+    {
+        stride <<= 1;
+    }
+    return true;
+}
+
+void IoUring::ReadAllBase::finish(const io_uring_cqe& cqe,
+                                  size_t size) const
+{
+    if (size != done)
+    {
+        throw exception::Incomplete(
+            std::format("io_uring readAll extra {}B", size - done));
+    }
+    checkCQE(cqe, "io_uring readAll");
+}
+
+void IoUring::FsyncOp::prep(io_uring_sqe& sqe) noexcept
+{
+    io_uring_prep_fsync(&sqe, fd, datasync ? IORING_FSYNC_DATASYNC : 0);
+}
+
+void IoUring::FsyncOp::finish(const io_uring_cqe& cqe) const
+{
+    checkCQE(cqe, "io_uring fsync");
+}
+
+void IoUring::OpenatOp::prep(io_uring_sqe& sqe) noexcept
+{
+    io_uring_prep_openat(&sqe, dirfd, path, flags, mode);
+}
+
+DupableFd IoUring::OpenatOp::finish(const io_uring_cqe& cqe) const
+{
+    auto fd = checkCQE(cqe, "io_uring openat");
+    return DupableFd(std::move(fd));
+}
+
+void IoUring::StatxOp::prep(io_uring_sqe& sqe) noexcept
+{
+    io_uring_prep_statx(&sqe, dirfd, path, flags, mask, buf);
+}
+
+struct statx& IoUring::StatxOp::finish(const io_uring_cqe& cqe) const
+{
+    checkCQE(cqe, "io_uring statx");
+    return *buf;
+}
+
+IoUring::Awaitable<IoUring::ReadOp> IoUring::read(int fd,
+                                                  std::span<std::byte> buf,
+                                                  uint64_t offset)
+{
+    return Awaitable<ReadOp>(*this, fd, buf, offset);
+}
+
+IoUring::Awaitable<IoUring::WriteOp> IoUring::write(
+    int fd, std::span<const std::byte> data, uint64_t offset)
+{
+    return Awaitable<WriteOp>(*this, fd, data, offset);
+}
+
+IoUring::Awaitable<IoUring::ReadExactOp> IoUring::readExact(
+    int fd, std::span<std::byte> buf, uint64_t offset)
+{
+    return Awaitable<ReadExactOp>(*this, fd, buf, offset);
+}
+
+IoUring::Awaitable<IoUring::WriteExactOp> IoUring::writeExact(
+    int fd, std::span<const std::byte> data, uint64_t offset)
+{
+    return Awaitable<WriteExactOp>(*this, fd, data, offset);
+}
+
+IoUring::Awaitable<IoUring::FsyncOp> IoUring::fsync(int fd, bool datasync)
+{
+    return Awaitable<FsyncOp>(*this, fd, datasync);
+}
+
+IoUring::Awaitable<IoUring::OpenatOp> IoUring::openat(const_zstring path,
+                                                      fd::OpenFlags flags,
+                                                      mode_t mode, int dirfd)
+{
+    return Awaitable<OpenatOp>(*this, dirfd, path.c_str(),
+                               static_cast<int>(flags), mode);
+}
+
+IoUring::Awaitable<IoUring::StatxOp> IoUring::statx(const_zstring path,
+                                                    struct statx& buf,
+                                                    int flags, unsigned mask,
+                                                    int dirfd)
+{
+    return Awaitable<StatxOp>(*this, dirfd, path.c_str(), flags, mask, &buf);
+}
+
+IoUring::Awaitable<IoUring::ReadFixedOp> IoUring::readFixed(
+    int fd, const BufferHandle& buf, uint64_t offset)
+{
+    return Awaitable<ReadFixedOp>(*this, fd, buf.get(), buf.index(), offset);
+}
+
+IoUring::Awaitable<IoUring::WriteFixedOp> IoUring::writeFixed(
+    int fd, const BufferHandle& buf, std::span<const std::byte> data,
+    uint64_t offset)
+{
+    return Awaitable<WriteFixedOp>(*this, fd, data, buf.index(), offset);
+}
+
+IoUring::Awaitable<IoUring::AcceptOp> IoUring::accept(int fd)
+{
+    return Awaitable<AcceptOp>(*this, fd, nullptr);
+}
+
+IoUring::Awaitable<IoUring::AcceptOp> IoUring::accept(int fd,
+                                                      SockAddrBuf& addr)
+{
+    return Awaitable<AcceptOp>(*this, fd, &addr);
+}
+
+IoUring::Awaitable<IoUring::TimeoutOp> IoUring::timeout(
+    std::chrono::nanoseconds timeout)
+{
+    return Awaitable<TimeoutOp>(*this, chronoToKTS(timeout));
+}
+
+void IoUring::submitAndWait(unsigned min_complete)
+{
+    countSQEs();
+    CHECK_RET(io_uring_submit_and_wait(&ring, min_complete),
+              "io_uring_submit_and_wait");
+}
+
+void IoUring::submitAndWait(unsigned min_complete,
+                            std::chrono::nanoseconds timeout)
+{
+    countSQEs();
+    io_uring_cqe* cqe;
+    auto kts = chronoToKTS(timeout);
+    auto ret = io_uring_submit_and_wait_timeout(&ring, &cqe, min_complete, &kts,
+                                                nullptr);
+    if (ret != -ETIME)
+    {
+        CHECK_RET(ret, "io_uring_submit_and_wait_timeout");
+    }
+}
+
+void IoUring::runUntil(function_view<bool()> done, unsigned min_complete)
+{
+    while (!done())
+    {
+        submitAndWait(min_complete);
+        process();
+    }
+}
+
+void IoUring::runUntil(function_view<bool()> done, unsigned min_complete,
+                       std::chrono::nanoseconds timeout)
+{
+    while (!done())
+    {
+        submitAndWait(min_complete, timeout);
+        process();
+    }
+}
+
 ManagedFd& IoUring::getEventFd()
 {
     if (event_fd)
@@ -153,14 +1051,33 @@ ManagedFd& IoUring::getEventFd()
     return *(event_fd = std::move(efd));
 }
 
+void IoUring::registerEpoll(int epfd, uint64_t data)
+{
+    epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.u64 = data;
+    CHECK_ERRNO(epoll_ctl(epfd, EPOLL_CTL_ADD, getEventFd().get(), &ev),
+                "epoll_ctl");
+}
+
 void IoUring::processEvents()
 {
     auto& efd = getEventFd();
+    // A single read resets the counter for all of the signalled CQEs
     std::byte b[8];
-    while (!fd::read(efd, b).empty())
+    fd::read(efd, b);
+    if (io_uring_cq_eventfd_toggle(&ring, false) != 0)
     {
         process();
+        return;
     }
+    // Completions arriving while we drain are reaped by this call, there
+    // is no need to wake up the event loop for them
+    process();
+    io_uring_cq_eventfd_toggle(&ring, true);
+    // Pick up completions which arrived after the drain but before the
+    // eventfd was enabled again, those were never signalled
+    process();
 }
 
 void IoUring::dropHandler(CQEHandler* h, io_uring_cqe& cqe) noexcept
@@ -169,12 +1086,14 @@ void IoUring::dropHandler(CQEHandler* h, io_uring_cqe& cqe) noexcept
     {
         return;
     }
-    auto it = std::find(handlers.begin(), handlers.end(), h);
-    if (it != handlers.end() - 1)
+    // Multishot requests keep their handler until the final CQE
+    if (!(cqe.flags & IORING_CQE_F_MORE) && --h->refs == 0)
     {
-        std::swap(*it, handlers.back());
+        auto last = handlers.back();
+        handlers[h->slot] = last;
+        last->slot = h->slot;
+        handlers.pop_back();
     }
-    handlers.pop_back();
     h->handleCQE(cqe);
 }
 
@@ -191,6 +1110,80 @@ void IoUring::setFile(unsigned slot, int fd) noexcept
     files[slot] = fd;
 }
 
+void IoUring::growFiles(size_t size)
+{
+    if (size > filesCapacity)
+    {
+        registerFileTable(size);
+    }
+
+    // New slots are handed out after existing free slots, lowest first
+    auto old_size = files.size();
+    files.resize(size, -1);
+    filesFree.insert(filesFree.begin(), size - old_size, 0);
+    for (size_t i = 0; i < size - old_size; ++i)
+    {
+        filesFree[i] = size - i - 1;
+    }
+}
+
+void IoUring::registerFileTable(size_t size)
+{
+    // The kernel can't resize a registered table, so register one large
+    // sparse table and only install entries with updates afterwards. Tables
+    // are limited by the number of files the process may open.
+    constexpr size_t defaultCapacity = 4096;
+    auto capacity = std::max(size, defaultCapacity);
+    rlimit lim;
+    if (getrlimit(RLIMIT_NOFILE, &lim) == 0)
+    {
+        capacity = std::max<size_t>(
+            size, std::min<rlim_t>(capacity, lim.rlim_cur));
+    }
+
+    // Older kernels without sparse tables need every slot up front, make
+    // sure we don't fail to allocate once the old table is gone
+    std::vector<int> table(capacity, -1);
+    std::copy(files.begin(), files.end(), table.begin());
+    if (filesCapacity > 0)
+    {
+        io_uring_unregister_files(&ring);
+    }
+    auto ret = installFileTable(table);
+    if (ret < 0)
+    {
+        if (filesCapacity > 0)
+        {
+            // Keep the existing slots working with the previous table
+            table.resize(filesCapacity);
+            installFileTable(table);
+        }
+        throw util::makeSystemError(-ret, "io_uring_register_files");
+    }
+    filesCapacity = capacity;
+}
+
+int IoUring::installFileTable(std::span<const int> table) noexcept
+{
+    auto ret = io_uring_register_files_sparse(&ring, table.size());
+    if (ret == -EINVAL)
+    {
+        return io_uring_register_files(&ring, table.data(), table.size());
+    }
+    if (ret < 0 || filesAllocated == 0)
+    {
+        return ret;
+    }
+    // Only the live entries need to be installed into a sparse table
+    ret = io_uring_register_files_update(&ring, 0, table.data(), files.size());
+    if (ret < 0)
+    {
+        io_uring_unregister_files(&ring);
+        return ret;
+    }
+    return 0;
+}
+
 void IoUring::updateFile(unsigned slot, int fd)
 {
     setFile(slot, fd);
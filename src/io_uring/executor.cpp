@@ -0,0 +1,344 @@
+#include <sched.h>
+
+#include <stdplus/exception.hpp>
+#include <stdplus/io_uring/executor.hpp>
+#include <stdplus/print.hpp>
+#include <stdplus/util/cexec.hpp>
+
+#include <latch>
+#include <limits>
+#include <utility>
+
+namespace stdplus
+{
+
+static thread_local const IoUringExecutor* currentExecutor = nullptr;
+static thread_local size_t currentIdx = 0;
+
+IoUringExecutor::IoUringExecutor(size_t num, const IoUring::Setup& setup,
+                                 std::span<const unsigned> cpus) : outside(1)
+{
+    if (num == 0)
+    {
+        throw util::makeSystemError(EINVAL, "IoUringExecutor");
+    }
+    outside.setSQFull(IoUring::SQFull::Submit);
+    shards.reserve(num);
+    for (size_t i = 0; i < num; ++i)
+    {
+        shards.push_back(std::make_unique<Shard>());
+    }
+
+    std::latch started(num);
+    size_t i = 0;
+    try
+    {
+        for (; i < num; ++i)
+        {
+            std::optional<unsigned> cpu;
+            if (!cpus.empty())
+            {
+                cpu = cpus[i % cpus.size()];
+            }
+            auto& shard = *shards[i];
+            shard.thread = std::thread([this, &setup, &started, &shard, i,
+                                        cpu]() {
+                try
+                {
+                    if (cpu)
+                    {
+                        cpu_set_t set;
+                        CPU_ZERO(&set);
+                        CPU_SET(*cpu, &set);
+                        CHECK_ERRNO(sched_setaffinity(0, sizeof(set), &set),
+                                    "sched_setaffinity");
+                    }
+                    // Rings are created by their own thread so they may
+                    // restrict submissions to a single issuer
+                    shard.ring.emplace(setup);
+                    shard.ring->setSQFull(IoUring::SQFull::Submit);
+                    shard.ring->setMsgHandler(&shard);
+                }
+                catch (...)
+                {
+                    shard.error = std::current_exception();
+                }
+                currentExecutor = this;
+                currentIdx = i;
+                bool ok = !shard.error;
+                started.count_down();
+                if (ok)
+                {
+                    run(shard, i);
+                }
+            });
+        }
+    }
+    catch (...)
+    {
+        started.count_down(num - i);
+        started.wait();
+        abort(i);
+        throw;
+    }
+    started.wait();
+
+    for (auto& shard : shards)
+    {
+        if (shard->error)
+        {
+            abort(num);
+            std::rethrow_exception(shard->error);
+        }
+    }
+}
+
+void IoUringExecutor::abort(size_t started) noexcept
+{
+    // Healthy shards may already be sleeping in their ring
+    exception::ignore([this] { stop(); })();
+    for (size_t i = 0; i < started; ++i)
+    {
+        shards[i]->thread.join();
+    }
+}
+
+IoUringExecutor::~IoUringExecutor()
+{
+    stop();
+    for (auto& shard : shards)
+    {
+        shard->thread.join();
+    }
+}
+
+size_t IoUringExecutor::shardFor(int fd) const
+{
+    if (fd < 0)
+    {
+        throw util::makeSystemError(EBADF, "IoUringExecutor::shardFor");
+    }
+    return static_cast<size_t>(fd) % shards.size();
+}
+
+std::optional<size_t> IoUringExecutor::currentShard() const noexcept
+{
+    if (currentExecutor != this)
+    {
+        return std::nullopt;
+    }
+    return currentIdx;
+}
+
+void IoUringExecutor::post(size_t shard, Task task)
+{
+    auto& s = *shards.at(shard);
+    {
+        std::lock_guard lk(s.lock);
+        if (s.dead)
+        {
+            throw util::makeSystemError(ESHUTDOWN, "IoUringExecutor::post");
+        }
+        s.pinned.push_back(std::move(task));
+    }
+    wake(s);
+}
+
+void IoUringExecutor::spawn(Task task)
+{
+    auto cur = currentShard();
+    auto idx = cur ? *cur
+                   : next.fetch_add(1, std::memory_order_relaxed) %
+                         shards.size();
+    auto& s = *shards[idx];
+    {
+        std::lock_guard lk(s.lock);
+        s.shared.push_back(std::move(task));
+    }
+    // We are busy running this task, or the target is busy with others,
+    // so let an idle shard steal the new one
+    if (cur || !wake(s))
+    {
+        wakeIdle(idx);
+    }
+}
+
+void IoUringExecutor::stop()
+{
+    stopping = true;
+    for (auto& shard : shards)
+    {
+        // Shards which failed to start never became idle, so this skips
+        // them without touching their ring
+        wake(*shard);
+    }
+}
+
+void IoUringExecutor::run(Shard& shard, size_t idx) noexcept
+{
+    try
+    {
+        runLoop(shard, idx);
+    }
+    catch (const std::exception& e)
+    {
+        // The ring is unusable, leave the shared tasks to the other shards.
+        // Pinned tasks can only run here, so they are dropped and posting
+        // more fails.
+        shard.idle = false;
+        std::deque<Task> dropped;
+        {
+            std::lock_guard lk(shard.lock);
+            shard.dead = true;
+            dropped.swap(shard.pinned);
+        }
+        stdplus::print(stderr, "IoUringExecutor shard {} failed: {}\n", idx,
+                       e.what());
+    }
+}
+
+void IoUringExecutor::runLoop(Shard& shard, size_t idx)
+{
+    // Only a bounded batch of tasks runs between reaping completions so
+    // neither can starve the other
+    constexpr size_t batch = 32;
+    auto& ring = *shard.ring;
+    while (true)
+    {
+        bool ran = false;
+        for (size_t i = 0; i < batch; ++i)
+        {
+            auto task = take(idx);
+            if (!task)
+            {
+                break;
+            }
+            exception::ignore(std::move(task))(ring);
+            ran = true;
+        }
+        ring.submit();
+        if (ring.process(std::numeric_limits<size_t>::max()) > 0 || ran)
+        {
+            continue;
+        }
+
+        // Wakers only send a message if they observe the flag, so it needs
+        // to be set before checking for new work one last time
+        shard.idle = true;
+        if (hasWork(idx))
+        {
+            shard.idle = false;
+            continue;
+        }
+        if (stopping)
+        {
+            break;
+        }
+        try
+        {
+            ring.submitAndWait();
+        }
+        catch (const std::system_error& e)
+        {
+            if (e.code() != std::errc::interrupted)
+            {
+                throw;
+            }
+        }
+        shard.idle = false;
+    }
+}
+
+IoUringExecutor::Task IoUringExecutor::take(size_t idx)
+{
+    {
+        auto& s = *shards[idx];
+        std::lock_guard lk(s.lock);
+        auto& q = s.pinned.empty() ? s.shared : s.pinned;
+        if (!q.empty())
+        {
+            auto task = std::move(q.front());
+            q.pop_front();
+            return task;
+        }
+    }
+    // Steal the most recently spawned task of a peer, the owner takes the
+    // oldest ones which keeps contention on the same end low
+    for (size_t i = 1; i < shards.size(); ++i)
+    {
+        auto& s = *shards[(idx + i) % shards.size()];
+        std::lock_guard lk(s.lock);
+        if (!s.shared.empty())
+        {
+            auto task = std::move(s.shared.back());
+            s.shared.pop_back();
+            return task;
+        }
+    }
+    return nullptr;
+}
+
+bool IoUringExecutor::hasWork(size_t idx)
+{
+    {
+        auto& s = *shards[idx];
+        std::lock_guard lk(s.lock);
+        if (!s.pinned.empty() || !s.shared.empty())
+        {
+            return true;
+        }
+    }
+    // Tasks spawned while we were busy may not have woken anyone
+    for (size_t i = 1; i < shards.size(); ++i)
+    {
+        auto& s = *shards[(idx + i) % shards.size()];
+        std::lock_guard lk(s.lock);
+        if (!s.shared.empty())
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool IoUringExecutor::wake(Shard& shard)
+{
+    if (!shard.idle.exchange(false))
+    {
+        return false;
+    }
+    try
+    {
+        if (auto cur = currentShard(); cur)
+        {
+            auto& ring = *shards[*cur]->ring;
+            ring.msgRing(*shard.ring, 0);
+            ring.submit();
+            return true;
+        }
+        std::lock_guard lk(outsideLock);
+        outside.msgRing(*shard.ring, 0);
+        outside.submit();
+        outside.process();
+        return true;
+    }
+    catch (...)
+    {
+        // The shard is still asleep, let the next waker try again
+        shard.idle = true;
+        throw;
+    }
+}
+
+void IoUringExecutor::wakeIdle(size_t idx)
+{
+    for (size_t i = 1; i < shards.size(); ++i)
+    {
+        if (wake(*shards[(idx + i) % shards.size()]))
+        {
+            return;
+        }
+    }
+}
+
+} // namespace stdplus
@@ -1,12 +1,19 @@
 #include <fmt/compile.h>
+#include <fcntl.h>
 #include <sys/mman.h>
+#include <unistd.h>
 
+#include <stdplus/exception.hpp>
 #include <stdplus/fd/fmt.hpp>
+#include <stdplus/fd/gmock.hpp>
 #include <stdplus/fd/managed.hpp>
 #include <stdplus/util/cexec.hpp>
 
+#include <array>
+#include <span>
 #include <string>
 #include <string_view>
+#include <vector>
 
 #include <gtest/gtest.h>
 
@@ -15,6 +22,7 @@ namespace stdplus
 namespace fd
 {
 
+using testing::_;
 using std::literals::string_view_literals::operator""sv;
 
 TEST(FormatBuffer, Basic)
@@ -38,5 +46,135 @@ TEST(FormatBuffer, Basic)
     EXPECT_EQ(4109, fd.lseek(0, Whence::Cur));
 }
 
+static std::string str(std::span<const iovec> iov)
+{
+    std::string ret;
+    for (const auto& v : iov)
+    {
+        ret.append(static_cast<const char*>(v.iov_base), v.iov_len);
+    }
+    return ret;
+}
+
+TEST(FormatBuffer, DoubleBuffer)
+{
+    testing::StrictMock<FdMock> fd;
+    std::string written;
+    auto take = [&](size_t n) {
+        return [&, n](std::span<const iovec> iov) {
+            auto data = str(iov);
+            EXPECT_LE(n, data.size());
+            written += data.substr(0, n);
+            return n;
+        };
+    };
+    {
+        testing::InSequence seq;
+        EXPECT_CALL(fd, writev(_)).WillOnce(take(2));
+        EXPECT_CALL(fd, writev(_)).WillOnce(take(0));
+        EXPECT_CALL(fd, writev(_))
+            .WillOnce([&](std::span<const iovec> iov) {
+                EXPECT_EQ(2, iov.size());
+                EXPECT_EQ("cdefgh", str(iov));
+                written += "cdef";
+                return 4;
+            });
+        EXPECT_CALL(fd, writev(_)).WillOnce(take(2));
+    }
+
+    FormatBuffer buf(fd, 4, true);
+    buf.appends("abcd");
+    EXPECT_EQ(2, buf.buffered());
+    buf.appends("ef");
+    EXPECT_EQ(4, buf.buffered());
+    EXPECT_FALSE(buf.tryFlush());
+    EXPECT_EQ(4, buf.buffered());
+    // Nothing is retried until the owner sees the fd is writable
+    buf.appends("gh");
+    EXPECT_EQ(6, buf.buffered());
+    EXPECT_EQ("ab", written);
+    EXPECT_FALSE(buf.tryFlush());
+    EXPECT_EQ(2, buf.buffered());
+    EXPECT_EQ("abcdef", written);
+    EXPECT_TRUE(buf.tryFlush());
+    EXPECT_EQ(0, buf.buffered());
+    EXPECT_EQ("abcdefgh", written);
+    EXPECT_TRUE(buf.tryFlush());
+}
+
+TEST(FormatBuffer, DoubleBufferLimit)
+{
+    testing::StrictMock<FdMock> fd;
+    std::string written;
+    auto take = [&](size_t n) {
+        return [&, n](std::span<const iovec> iov) {
+            auto data = str(iov);
+            EXPECT_LE(n, data.size());
+            written += data.substr(0, n);
+            return n;
+        };
+    };
+    {
+        testing::InSequence seq;
+        EXPECT_CALL(fd, writev(_)).WillOnce(take(1));
+        EXPECT_CALL(fd, writev(_)).WillOnce(take(0));
+        EXPECT_CALL(fd, writev(_)).WillOnce(take(3));
+        EXPECT_CALL(fd, writev(_)).WillOnce(take(7));
+    }
+
+    FormatBuffer buf(fd, 4, true);
+    buf.appends("abcd");
+    buf.appends("efgh");
+    EXPECT_EQ(7, buf.buffered());
+    EXPECT_THROW(buf.appends("ij"), exception::WouldBlock);
+    EXPECT_EQ(9, buf.buffered());
+    buf.appends("k");
+    EXPECT_EQ(0, buf.buffered());
+    EXPECT_EQ("abcdefghijk", written);
+}
+
+TEST(FormatBuffer, DoubleBufferPipe)
+{
+    std::array<int, 2> fds;
+    CHECK_ERRNO(pipe2(fds.data(), O_NONBLOCK), "pipe2");
+    ManagedFd r(std::move(fds[0])), w(std::move(fds[1]));
+    auto size = CHECK_ERRNO(fcntl(w.get(), F_GETPIPE_SZ), "fcntl");
+
+    std::string out;
+    {
+        FormatBuffer buf(w, size, true);
+        std::string line(100, 'a');
+        // Formatting continues while the pipe is full until the limit
+        EXPECT_THROW(
+            while (true) { buf.appends(line); }, exception::WouldBlock);
+        EXPECT_LT(2 * size, buf.buffered());
+        EXPECT_FALSE(buf.tryFlush());
+        std::vector<char> tmp(size);
+        while (true)
+        {
+            auto n = ::read(r.get(), tmp.data(), tmp.size());
+            if (n <= 0)
+            {
+                break;
+            }
+            out.append(tmp.data(), n);
+            if (buf.tryFlush())
+            {
+                break;
+            }
+        }
+        buf.appends("end");
+    }
+    std::vector<char> tmp(4096);
+    ssize_t n;
+    while ((n = ::read(r.get(), tmp.data(), tmp.size())) > 0)
+    {
+        out.append(tmp.data(), n);
+    }
+    ASSERT_LT(3, out.size());
+    EXPECT_EQ("end", out.substr(out.size() - 3));
+    EXPECT_EQ(std::string(out.size() - 3, 'a'), out.substr(0, out.size() - 3));
+}
+
 } // namespace fd
 } // namespace stdplus
@@ -44,6 +44,20 @@ TEST(LineReader, SomeData)
     EXPECT_THROW(reader.readLine(), exception::Eof);
 }
 
+TEST(LineReader, Move)
+{
+    auto fd = makeMemfd("A\nbc\n");
+    LineReader reader = fd;
+    EXPECT_EQ("A", *reader.readLineView());
+    // Buffered data moves along with the reader
+    LineReader moved(std::move(reader));
+    EXPECT_EQ("bc", *moved.readLineView());
+    LineReader big(fd, LineReader::buf_size * 2);
+    big = std::move(moved);
+    EXPECT_EQ("", *big.readLine());
+    EXPECT_THROW(big.readLine(), exception::Eof);
+}
+
 TEST(LineReader, LargerThanBuf)
 {
     std::string big(LineReader::buf_size + 10, 'a');
@@ -56,6 +70,90 @@ TEST(LineReader, LargerThanBuf)
     EXPECT_THROW(reader.readLine(), exception::Eof);
 }
 
+TEST(LineReader, View)
+{
+    std::string big(LineReader::buf_size + 10, 'a');
+    auto fd = makeMemfd(std::string("A\nbcd\n\n") + big + "\ndef\ne");
+    LineReader reader(fd);
+    EXPECT_EQ("A", *reader.readLineView());
+    EXPECT_EQ("bcd", *reader.readLine());
+    EXPECT_EQ("", *reader.readLineView());
+    EXPECT_EQ(big, *reader.readLineView());
+    EXPECT_EQ("def", *reader.readLineView());
+    EXPECT_EQ("e", *reader.readLineView());
+    EXPECT_THROW(reader.readLineView(), exception::Eof);
+    EXPECT_THROW(reader.readLine(), exception::Eof);
+}
+
+TEST(LineReader, ViewEmpty)
+{
+    auto fd = makeMemfd("a\n");
+    LineReader reader(fd);
+    EXPECT_EQ("a", *reader.readLineView());
+    EXPECT_EQ("", *reader.readLineView());
+    EXPECT_THROW(reader.readLineView(), exception::Eof);
+}
+
+TEST(LineReader, Delimiter)
+{
+    // A tiny buffer splits the delimiters across reads
+    auto fd = makeMemfd("ab\r\nc\rd\r\n\r\ne\r");
+    LineReader reader(fd, 3);
+    EXPECT_THROW(reader.setDelimiter(""), std::system_error);
+    EXPECT_THROW(reader.setDelimiter("abcd"), std::system_error);
+    reader.setDelimiter("\r\n");
+    EXPECT_EQ("ab", *reader.readLine());
+    EXPECT_EQ("c\rd", *reader.readLineView());
+    EXPECT_EQ("", *reader.readLine());
+    EXPECT_EQ("e\r", *reader.readLine());
+    EXPECT_THROW(reader.readLine(), exception::Eof);
+}
+
+TEST(LineReader, NulDelimiter)
+{
+    using std::literals::string_view_literals::operator""sv;
+    auto fd = makeMemfd("/bin/sh\0-c\0true\0"sv);
+    LineReader reader(fd, 1 << 20);
+    reader.setDelimiter({"", 1});
+    EXPECT_EQ("/bin/sh", *reader.readLineView());
+    EXPECT_EQ("-c", *reader.readLineView());
+    EXPECT_EQ("true", *reader.readLineView());
+    EXPECT_EQ("", *reader.readLineView());
+    EXPECT_THROW(reader.readLineView(), exception::Eof);
+}
+
+TEST(LineReader, MaxLine)
+{
+    auto fd = makeMemfd("abc\nabcdefgh\nab\nabcdefgh");
+    LineReader reader(fd, 4);
+    reader.setMaxLine(3);
+    EXPECT_EQ("abc", *reader.readLine());
+    try
+    {
+        reader.readLineView();
+        ADD_FAILURE();
+    }
+    catch (const std::system_error& e)
+    {
+        EXPECT_EQ(EMSGSIZE, e.code().value());
+    }
+    EXPECT_EQ("ab", *reader.readLineView());
+    EXPECT_THROW(reader.readLine(), std::system_error);
+    EXPECT_THROW(reader.readLine(), exception::Eof);
+}
+
+TEST(LineReader, TryReadLine)
+{
+    auto fd = makeMemfd("A\nbc");
+    LineReader reader(fd);
+    EXPECT_EQ("A", **reader.tryReadLine());
+    EXPECT_EQ("bc", **reader.tryReadLine());
+    auto ret = reader.tryReadLine();
+    ASSERT_FALSE(ret);
+    EXPECT_TRUE(ret.error().eof());
+    EXPECT_THROW(reader.readLine(), exception::Eof);
+}
+
 using testing::_;
 
 TEST(LineReader, Nonblock)
@@ -77,5 +175,44 @@ TEST(LineReader, Nonblock)
     EXPECT_THROW(reader.readLine(), exception::Eof);
 }
 
+TEST(LineReader, ViewNonblock)
+{
+    FdMock fd;
+    {
+        testing::InSequence seq;
+        EXPECT_CALL(fd, read(_)).WillOnce(readSv(""));
+        EXPECT_CALL(fd, read(_)).WillOnce(readSv("alph"));
+        EXPECT_CALL(fd, read(_)).WillOnce(readSv(""));
+        EXPECT_CALL(fd, read(_)).WillOnce(readSv("a\nb\nc"));
+        EXPECT_CALL(fd, read(_))
+            .WillRepeatedly(testing::Throw(stdplus::exception::Eof("test")));
+    }
+
+    LineReader reader(fd);
+    EXPECT_EQ(std::nullopt, reader.readLineView());
+    EXPECT_EQ(std::nullopt, reader.readLineView());
+    EXPECT_EQ("alpha", *reader.readLineView());
+    EXPECT_EQ("b", *reader.readLineView());
+    EXPECT_EQ("c", *reader.readLineView());
+    EXPECT_THROW(reader.readLineView(), exception::Eof);
+}
+
+TEST(LineReader, TryReadLineError)
+{
+    FdMock fd;
+    {
+        testing::InSequence seq;
+        EXPECT_CALL(fd, read(_)).WillOnce(readSv("alph"));
+        EXPECT_CALL(fd, read(_))
+            .WillOnce(testing::Throw(std::system_error(
+                std::make_error_code(std::errc::connection_reset), "test")));
+    }
+
+    LineReader reader(fd);
+    auto ret = reader.tryReadLine();
+    ASSERT_FALSE(ret);
+    EXPECT_EQ(ECONNRESET, ret.error().err);
+}
+
 } // namespace fd
 } // namespace stdplus
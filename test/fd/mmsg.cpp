@@ -0,0 +1,109 @@
+#include <sys/socket.h>
+
+#include <stdplus/exception.hpp>
+#include <stdplus/fd/gmock.hpp>
+#include <stdplus/fd/managed.hpp>
+#include <stdplus/fd/mmsg.hpp>
+#include <stdplus/util/cexec.hpp>
+
+#include <array>
+#include <cstring>
+#include <string_view>
+
+#include <gtest/gtest.h>
+
+namespace stdplus::fd
+{
+
+using testing::_;
+using std::literals::string_view_literals::operator""sv;
+
+static std::span<const std::byte> bytes(std::string_view s)
+{
+    return std::as_bytes(std::span(s));
+}
+
+static std::string_view str(std::span<const std::byte> s)
+{
+    return {reinterpret_cast<const char*>(s.data()), s.size()};
+}
+
+TEST(MsgBatch, SocketPair)
+{
+    std::array<int, 2> fds;
+    CHECK_ERRNO(socketpair(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK, 0, fds.data()),
+                "socketpair");
+    ManagedFd a(std::move(fds[0])), b(std::move(fds[1]));
+
+    MsgBatch batch(3, 4);
+    EXPECT_EQ(3, batch.capacity());
+    EXPECT_TRUE(batch.recv(b).empty());
+
+    EXPECT_TRUE(batch.push(bytes("a")));
+    EXPECT_TRUE(batch.push(bytes("")));
+    EXPECT_TRUE(batch.push(bytes("bcde")));
+    EXPECT_FALSE(batch.push(bytes("f")));
+    EXPECT_THROW(batch.push(bytes("ghijk")), std::system_error);
+    EXPECT_EQ(3, batch.send(a));
+    EXPECT_EQ(0, batch.pending());
+    EXPECT_TRUE(batch.push(bytes("lmnopq").first(4)));
+    EXPECT_EQ(1, batch.send(a));
+    EXPECT_EQ(6, ::send(a.get(), "123456", 6, 0));
+
+    auto msgs = batch.recv(b);
+    ASSERT_EQ(3, msgs.size());
+    EXPECT_EQ("a", str(msgs[0].data));
+    EXPECT_EQ("", str(msgs[1].data));
+    EXPECT_EQ("bcde", str(msgs[2].data));
+    EXPECT_FALSE(msgs[2].truncated);
+
+    msgs = batch.recv(b);
+    ASSERT_EQ(2, msgs.size());
+    EXPECT_EQ("lmno", str(msgs[0].data));
+    EXPECT_FALSE(msgs[0].truncated);
+    EXPECT_EQ("1234", str(msgs[1].data));
+    EXPECT_TRUE(msgs[1].truncated);
+}
+
+TEST(MsgBatch, PartialSend)
+{
+    testing::StrictMock<FdMock> fd;
+    MsgBatch batch(4, 8);
+    SockAddrBuf addr = Sock4Addr{.addr = In4Addr{127, 0, 0, 1}, .port = 80}
+                           .buf();
+    EXPECT_EQ(0, batch.send(fd));
+    ASSERT_TRUE(batch.push(bytes("one"), addr));
+    ASSERT_TRUE(batch.push(bytes("two")));
+    ASSERT_TRUE(batch.push(bytes("three"), addr));
+    {
+        testing::InSequence seq;
+        EXPECT_CALL(fd, sendmmsg(_, _))
+            .WillOnce([&](std::span<mmsghdr> msgs, SendFlags) {
+                EXPECT_EQ(3, msgs.size());
+                EXPECT_EQ(addr.len, msgs[0].msg_hdr.msg_namelen);
+                EXPECT_EQ(0, std::memcmp(msgs[0].msg_hdr.msg_name, &addr,
+                                         addr.len));
+                EXPECT_EQ(nullptr, msgs[1].msg_hdr.msg_name);
+                return 1;
+            });
+        EXPECT_CALL(fd, sendmmsg(_, _)).WillOnce(testing::Return(0));
+        EXPECT_CALL(fd, sendmmsg(_, _))
+            .WillOnce([&](std::span<mmsghdr> msgs, SendFlags) {
+                EXPECT_EQ(3, msgs.size());
+                auto& iov = *msgs[1].msg_hdr.msg_iov;
+                EXPECT_EQ("three",
+                          str({static_cast<std::byte*>(iov.iov_base),
+                               iov.iov_len}));
+                return 3;
+            });
+    }
+    EXPECT_EQ(1, batch.send(fd));
+    EXPECT_EQ(2, batch.pending());
+    ASSERT_TRUE(batch.push(bytes("four")));
+    EXPECT_FALSE(batch.push(bytes("five")));
+    EXPECT_EQ(0, batch.send(fd));
+    EXPECT_EQ(3, batch.send(fd));
+    EXPECT_EQ(0, batch.pending());
+}
+
+} // namespace stdplus::fd
@@ -5,6 +5,10 @@
 #include <stdplus/fd/ops.hpp>
 #include <stdplus/numeric/endian.hpp>
 
+#include <array>
+#include <cstring>
+#include <string>
+
 #include <gtest/gtest.h>
 
 namespace stdplus::fd
@@ -107,6 +111,246 @@ TEST(ReadExact, EnoughInt)
     EXPECT_EQ(ntoh(i), 0x01020304);
 }
 
+static std::string iovStr(std::span<const iovec> iov)
+{
+    std::string ret;
+    for (const auto& v : iov)
+    {
+        ret.append(reinterpret_cast<const char*>(v.iov_base), v.iov_len);
+        ret.push_back('|');
+    }
+    return ret;
+}
+
+TEST(WritevExact, Success)
+{
+    testing::StrictMock<FdMock> fd;
+    {
+        testing::InSequence seq;
+        EXPECT_CALL(fd, writev(testing::ResultOf(iovStr, "ab|cde|f|")))
+            .WillOnce(testing::Return(3));
+        EXPECT_CALL(fd, writev(testing::ResultOf(iovStr, "de|f|")))
+            .WillOnce(testing::Return(2));
+        EXPECT_CALL(fd, writev(testing::ResultOf(iovStr, "f|")))
+            .WillOnce(testing::Return(1));
+    }
+    auto a = "ab"sv, b = ""sv, c = "cde"sv, d = "f"sv;
+    std::array<std::span<const std::byte>, 4> bufs = {
+        std::as_bytes(std::span(a)), std::as_bytes(std::span(b)),
+        std::as_bytes(std::span(c)), std::as_bytes(std::span(d))};
+    writevExact(fd, bufs);
+}
+
+TEST(WritevExact, NotEnough)
+{
+    testing::StrictMock<FdMock> fd;
+    {
+        testing::InSequence seq;
+        EXPECT_CALL(fd, writev(_)).WillOnce(testing::Return(0));
+        EXPECT_CALL(fd, writev(_)).WillOnce(testing::Return(1));
+        EXPECT_CALL(fd, writev(_)).WillOnce(testing::Return(0));
+    }
+    auto a = "ab"sv;
+    std::array bufs = {std::as_bytes(std::span(a))};
+    EXPECT_THROW(writevExact(fd, bufs), exception::WouldBlock);
+    EXPECT_THROW(writevExact(fd, bufs), exception::Incomplete);
+}
+
+TEST(ReadvExact, Memfd)
+{
+    auto fd = makeMemfd("alpha one");
+    std::array<char, 4> a;
+    std::array<char, 5> b;
+    std::array<std::span<std::byte>, 2> bufs = {
+        std::as_writable_bytes(std::span(a)),
+        std::as_writable_bytes(std::span(b))};
+    readvExact(fd, bufs);
+    EXPECT_EQ("alph", std::string_view(a.data(), a.size()));
+    EXPECT_EQ("a one", std::string_view(b.data(), b.size()));
+    EXPECT_THROW(readvExact(fd, bufs), exception::Eof);
+}
+
+TEST(Preadv2, Memfd)
+{
+    auto fd = makeMemfd("alpha one");
+    std::array<char, 3> a = {};
+    std::array<char, 3> b = {};
+    std::array iov = {iovec{a.data(), a.size()}, iovec{b.data(), b.size()}};
+    EXPECT_EQ(5, preadv2(fd, iov, 4));
+    EXPECT_EQ("a o", std::string_view(a.data(), a.size()));
+    EXPECT_EQ("ne\0"sv, std::string_view(b.data(), b.size()));
+    EXPECT_EQ(0, lseek(fd, 0, Whence::Cur));
+
+    b = {'x', 'y', 'z'};
+    EXPECT_EQ(6, pwritev2(fd, iov, 3, RWFlag::DSync));
+    EXPECT_EQ(0, lseek(fd, 0, Whence::Cur));
+    std::array<char, 9> c;
+    EXPECT_EQ(9, readv(fd, std::array{iovec{c.data(), c.size()}}));
+    EXPECT_EQ("alpa oxyz", std::string_view(c.data(), c.size()));
+}
+
+TEST(Vectored, Defaults)
+{
+    // Implementations without the vectored operations fall back to the
+    // plain ones, transferring the first non-empty buffer
+    testing::StrictMock<FdMock> fd;
+    {
+        testing::InSequence seq;
+        EXPECT_CALL(fd, read(SizeIs(3))).WillOnce(readSv("ab"));
+        EXPECT_CALL(fd, write(SizeIs(3)))
+            .WillOnce([](std::span<const std::byte> data) {
+                return data.first(1);
+            });
+        EXPECT_CALL(fd, pread(SizeIs(3), 5))
+            .WillOnce(testing::WithArg<0>(readSv("abc")));
+    }
+    std::array<char, 3> a;
+    std::array iov = {iovec{nullptr, 0}, iovec{a.data(), a.size()}};
+    EXPECT_EQ(2, fd.Fd::readv(iov));
+    EXPECT_EQ(1, fd.Fd::writev(iov));
+    EXPECT_EQ(3, fd.Fd::preadv2(iov, 5, {}));
+    EXPECT_EQ(0, fd.Fd::readv(std::span(iov).first(1)));
+    EXPECT_THROW(fd.Fd::pwritev2(iov, 5, RWFlag::NoWait), std::system_error);
+    EXPECT_THROW(fd.Fd::sendmmsg({}, {}), std::system_error);
+    EXPECT_THROW(fd.Fd::sendfile(fd, std::nullopt, 1), std::system_error);
+}
+
+TEST(PreadExact, Success)
+{
+    testing::StrictMock<FdMock> fd;
+    {
+        testing::InSequence seq;
+        EXPECT_CALL(fd, pread(SizeIs(5), 10))
+            .WillOnce(testing::WithArg<0>(readSv("alp")));
+        EXPECT_CALL(fd, pread(SizeIs(2), 13))
+            .WillOnce(testing::WithArg<0>(readSv("ha")));
+        EXPECT_CALL(fd, pread(SizeIs(5), 10))
+            .WillOnce(testing::WithArg<0>(readSv("alp")));
+        EXPECT_CALL(fd, pread(SizeIs(2), 13))
+            .WillOnce(testing::WithArg<0>(readSv("")));
+    }
+    char buf[5];
+    preadExact(fd, buf, 10);
+    EXPECT_EQ("alpha", std::string_view(buf, sizeof(buf)));
+    EXPECT_THROW(preadExact(fd, buf, 10), exception::Incomplete);
+}
+
+TEST(PwriteExact, Memfd)
+{
+    auto fd = makeMemfd("alpha one");
+    pwriteExact(fd, "two"sv, 6);
+    pwriteExact(fd, "zeta"sv, 9);
+    char buf[13];
+    preadExact(fd, buf, 0);
+    EXPECT_EQ("alpha twozeta", std::string_view(buf, sizeof(buf)));
+    EXPECT_EQ(0, lseek(fd, 0, Whence::Cur));
+    EXPECT_THROW(preadExact(fd, buf, 1), exception::Incomplete);
+}
+
+TEST(CopyFileRangeExact, Memfd)
+{
+    auto in = makeMemfd("alpha one");
+    auto out = makeMemfd("");
+    copyFileRangeExact(in, 6, out, std::nullopt, 3);
+    copyFileRangeExact(in, std::nullopt, out, std::nullopt, 5);
+    EXPECT_EQ(5, lseek(in, 0, Whence::Cur));
+    EXPECT_THROW(copyFileRangeExact(in, 8, out, 0, 2), exception::Incomplete);
+    sendfileExact(in, out, 0, 1);
+    EXPECT_THROW(sendfileExact(in, out, 9, 1), exception::Eof);
+
+    // Only real file descriptors can be copied to by the kernel
+    testing::StrictMock<FdMock> mock;
+    EXPECT_THROW(copyFileRange(in, 0, mock, std::nullopt, 1),
+                 std::system_error);
+    char buf[9];
+    preadExact(out, buf, 0);
+    EXPECT_EQ("enealphaa", std::string_view(buf, sizeof(buf)));
+}
+
+TEST(SpliceExact, Mock)
+{
+    testing::StrictMock<FdMock> fd, out;
+    {
+        testing::InSequence seq;
+        EXPECT_CALL(fd, splice(std::optional<off_t>(4), testing::Ref(out),
+                               std::optional<off_t>(), 6, _))
+            .WillOnce(testing::Return(2));
+        EXPECT_CALL(fd, splice(std::optional<off_t>(6), testing::Ref(out),
+                               std::optional<off_t>(), 4, _))
+            .WillOnce(testing::Return(0));
+    }
+    EXPECT_THROW(spliceExact(fd, 4, out, std::nullopt, 6),
+                 exception::Incomplete);
+}
+
+TEST(TryRead, Memfd)
+{
+    auto fd = makeMemfd("alpha");
+    char buf[4];
+    auto ret = tryRead(fd, buf);
+    ASSERT_TRUE(ret);
+    EXPECT_EQ("alph", std::string_view(ret->data(), ret->size()));
+    ret = tryRead(fd, buf);
+    ASSERT_TRUE(ret);
+    EXPECT_EQ("a", std::string_view(ret->data(), ret->size()));
+    ret = tryRead(fd, buf);
+    ASSERT_FALSE(ret);
+    EXPECT_TRUE(ret.error().eof());
+    EXPECT_THROW(ret.error().raise("test"), exception::Eof);
+
+    auto wret = trySend(fd, "a"sv);
+    ASSERT_FALSE(wret);
+    EXPECT_EQ(ENOTSOCK, wret.error().err);
+    EXPECT_THROW(wret.error().raise("test"), std::system_error);
+}
+
+TEST(TryRead, Mock)
+{
+    testing::StrictMock<FdMock> fd;
+    {
+        testing::InSequence seq;
+        EXPECT_CALL(fd, read(_)).WillOnce(readSv(""));
+        EXPECT_CALL(fd, read(_))
+            .WillOnce(testing::Throw(exception::Eof("test")));
+        EXPECT_CALL(fd, write(_))
+            .WillOnce(testing::Throw(std::system_error(
+                std::make_error_code(std::errc::broken_pipe), "test")));
+    }
+    int32_t i;
+    auto ret = tryRead(fd, std::span(&i, 1));
+    ASSERT_TRUE(ret);
+    EXPECT_TRUE(ret->empty());
+    ret = tryRead(fd, std::span(&i, 1));
+    ASSERT_FALSE(ret);
+    EXPECT_TRUE(ret.error().eof());
+    auto wret = tryWrite(fd, "a"sv);
+    ASSERT_FALSE(wret);
+    EXPECT_EQ(EPIPE, wret.error().err);
+}
+
+TEST(TryRead, PartialElement)
+{
+    testing::StrictMock<FdMock> fd;
+    {
+        testing::InSequence seq;
+        EXPECT_CALL(fd, read(_)).WillOnce(readSv("ab"));
+        EXPECT_CALL(fd, read(_)).WillOnce(readSv("cd"));
+        EXPECT_CALL(fd, read(_)).WillOnce(readSv("ab"));
+        EXPECT_CALL(fd, read(_))
+            .WillOnce(testing::Throw(exception::Eof("test")));
+    }
+    std::array<int32_t, 2> i;
+    // The partial element is completed instead of dropping its bytes
+    auto ret = tryRead(fd, i);
+    ASSERT_TRUE(ret);
+    EXPECT_EQ(1, ret->size());
+    EXPECT_EQ(0, std::memcmp("abcd", i.data(), 4));
+    ret = tryRead(fd, i);
+    ASSERT_FALSE(ret);
+    EXPECT_EQ(EILSEQ, ret.error().err);
+    EXPECT_THROW(ret.error().raise("test"), std::system_error);
+}
+
 TEST(Read, Success)
 {
     testing::StrictMock<FdMock> fd;
@@ -248,6 +492,79 @@ TEST(ReadAll, EnoughInt)
                            stdplus::hton(int32_t{0x05060708})}));
 }
 
+TEST(ReadAll, Hint)
+{
+    testing::StrictMock<FdMock> fd;
+    {
+        testing::InSequence seq;
+        EXPECT_CALL(fd, read(SizeIs(1001))).WillOnce(readSv("alpha"));
+        EXPECT_CALL(fd, read(SizeIs(996)))
+            .WillOnce(testing::Throw(exception::Eof("test")));
+    }
+    EXPECT_EQ(readAll<std::string>(fd, 1000), "alpha");
+}
+
+TEST(ReadAll, Doubling)
+{
+    testing::StrictMock<FdMock> fd;
+    auto fill = [](std::span<std::byte> buf) {
+        std::fill(buf.begin(), buf.end(), std::byte{'a'});
+        return buf;
+    };
+    {
+        testing::InSequence seq;
+        EXPECT_CALL(fd, read(SizeIs(256))).WillOnce(fill);
+        EXPECT_CALL(fd, read(SizeIs(256))).WillOnce(fill);
+        EXPECT_CALL(fd, read(SizeIs(512))).WillOnce(readSv("a"));
+        EXPECT_CALL(fd, read(SizeIs(511))).WillOnce(fill);
+        EXPECT_CALL(fd, read(SizeIs(1024)))
+            .WillOnce(testing::Throw(exception::Eof("test")));
+    }
+    EXPECT_EQ(readAll<std::string>(fd), std::string(1024, 'a'));
+}
+
+TEST(ReadAll, Reuse)
+{
+    std::string s;
+    s.reserve(4096);
+    auto data = s.data();
+    auto fd = makeMemfd("alpha");
+    readAll(fd, s);
+    EXPECT_EQ("alpha", s);
+    lseek(fd, 0, Whence::Set);
+    pwriteExact(fd, "one"sv, 5);
+    readAll(fd, s, 8);
+    EXPECT_EQ("alphaone", s);
+    EXPECT_EQ(data, s.data());
+}
+
+/** @brief A container providing only what readAll() always needed */
+struct MinimalBuf
+{
+    std::vector<char> buf;
+
+    char* data() noexcept
+    {
+        return buf.data();
+    }
+    size_t size() const noexcept
+    {
+        return buf.size();
+    }
+    void resize(size_t size)
+    {
+        buf.resize(size);
+    }
+};
+
+TEST(ReadAll, Minimal)
+{
+    auto fd = makeMemfd("alpha");
+    MinimalBuf buf;
+    readAll(fd, buf);
+    EXPECT_EQ("alpha", std::string_view(buf.data(), buf.size()));
+}
+
 TEST(ReadAllFixed, SuccessEmpty)
 {
     testing::StrictMock<FdMock> fd;
@@ -0,0 +1,129 @@
+#include "util.hpp"
+
+#include <unistd.h>
+
+#include <stdplus/fd/records.hpp>
+
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace stdplus::fd
+{
+
+static std::vector<std::string> readRecords(MMapRecords& records)
+{
+    std::vector<std::string> ret;
+    for (auto record : records)
+    {
+        ret.emplace_back(record);
+    }
+    return ret;
+}
+
+TEST(MMapRecords, Empty)
+{
+    auto fd = makeMemfd("");
+    MMapRecords records(fd);
+    EXPECT_EQ(std::vector<std::string>{""}, readRecords(records));
+    EXPECT_EQ(std::nullopt, records.next());
+    EXPECT_THROW(MMapRecords(fd, 0, ""), std::system_error);
+}
+
+TEST(MMapRecords, Lines)
+{
+    auto fd = makeMemfd("A\nbcd\n\ne");
+    lseek(fd, 2, Whence::Set);
+    MMapRecords records(fd);
+    EXPECT_EQ(2, lseek(fd, 0, Whence::Cur));
+    EXPECT_EQ((std::vector<std::string>{"A", "bcd", "", "e"}),
+              readRecords(records));
+
+    fd = makeMemfd("ab\r\n\r\nc\r");
+    MMapRecords crlf(fd, MMapRecords::window_size, "\r\n");
+    EXPECT_EQ((std::vector<std::string>{"ab", "", "c\r"}), readRecords(crlf));
+}
+
+TEST(MMapRecords, Windows)
+{
+    const size_t page = sysconf(_SC_PAGESIZE);
+    std::vector<std::string> expected;
+    std::string data;
+    // Records straddle every window boundary, and some are multiple
+    // windows long
+    for (size_t i = 0; data.size() < page * 8; ++i)
+    {
+        expected.push_back(std::string(i * 97 % (page * 3), 'a' + i % 26));
+        data += expected.back();
+        data += "\r\n";
+    }
+    expected.push_back("end");
+    data += "end";
+    auto fd = makeMemfd(data);
+    MMapRecords records(fd, page, "\r\n");
+    EXPECT_EQ(expected, readRecords(records));
+}
+
+TEST(ParallelRecords, Chunks)
+{
+    std::string data;
+    std::vector<std::string> expected;
+    for (size_t i = 0; i < 1000; ++i)
+    {
+        expected.push_back(std::string(i % 37, 'a' + i % 26));
+        data += expected.back();
+        data += "\r\n";
+    }
+    expected.emplace_back();
+    auto fd = makeMemfd(data);
+
+    for (size_t threads : {1, 4})
+    {
+        std::mutex lock;
+        std::map<size_t, std::vector<std::string>> chunks;
+        auto n = parallelRecords(
+            fd,
+            [&](size_t chunk, std::string_view record) {
+                std::lock_guard lk(lock);
+                chunks[chunk].emplace_back(record);
+            },
+            threads, "\r\n", 1000);
+        EXPECT_EQ(n, chunks.size());
+        EXPECT_GT(n, 10);
+        std::vector<std::string> records;
+        for (const auto& [_, chunk] : chunks)
+        {
+            records.insert(records.end(), chunk.begin(), chunk.end());
+        }
+        EXPECT_EQ(expected, records);
+    }
+}
+
+TEST(ParallelRecords, Edges)
+{
+    auto fd = makeMemfd("");
+    std::vector<std::string> records;
+    auto collect = [&](size_t, std::string_view record) {
+        records.emplace_back(record);
+    };
+    EXPECT_EQ(1, parallelRecords(fd, collect, 2));
+    EXPECT_EQ(std::vector<std::string>{""}, records);
+
+    records.clear();
+    fd = makeMemfd("abc");
+    EXPECT_EQ(1, parallelRecords(fd, collect, 2, "\n", 1));
+    EXPECT_EQ(std::vector<std::string>{"abc"}, records);
+
+    EXPECT_THROW(parallelRecords(
+                     fd, [](size_t, std::string_view) {
+                         throw std::runtime_error("test");
+                     },
+                     2, "b", 1),
+                 std::runtime_error);
+}
+
+} // namespace stdplus::fd
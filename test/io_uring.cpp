@@ -1,15 +1,31 @@
+#include <arpa/inet.h>
 #include <fmt/format.h>
+#include <netinet/in.h>
 #include <poll.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
 #include <sys/utsname.h>
 
+#include <stdplus/exception.hpp>
+#include <stdplus/fd/managed.hpp>
+#include <stdplus/fd/ops.hpp>
 #include <stdplus/io_uring.hpp>
+#include <stdplus/raw.hpp>
 #include <stdplus/util/cexec.hpp>
 
+#include <algorithm>
 #include <array>
 #include <charconv>
 #include <chrono>
+#include <coroutine>
+#include <cstdlib>
+#include <exception>
 #include <optional>
+#include <stdexcept>
 #include <string_view>
+#include <system_error>
+#include <vector>
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
@@ -128,7 +144,8 @@ TEST_F(IoUringTest, NullHandler)
     auto& sqe = ring.getSQE();
     io_uring_prep_nop(&sqe);
     ring.submit();
-    ring.process();
+    ring.wait();
+    EXPECT_EQ(0, ring.process(10));
 }
 
 TEST_F(IoUringTest, HandlerCalled)
@@ -184,6 +201,408 @@ TEST_F(IoUringTest, HandlerReplacement)
     testing::Mock::VerifyAndClearExpectations(&h[1]);
 }
 
+TEST(IoUringSetup, Params)
+{
+    auto setup = IoUring::Setup(32)
+                     .sqPoll(std::chrono::milliseconds(100), 1)
+                     .cqSize(64);
+    EXPECT_EQ(setup.getQueueSize(), 32);
+    const auto& params = setup.getParams();
+    EXPECT_EQ(params.flags,
+              IORING_SETUP_SQPOLL | IORING_SETUP_SQ_AFF | IORING_SETUP_CQSIZE);
+    EXPECT_EQ(params.sq_thread_idle, 100);
+    EXPECT_EQ(params.sq_thread_cpu, 1);
+    EXPECT_EQ(params.cq_entries, 64);
+
+    EXPECT_EQ(IoUring::Setup().deferTaskrun().getParams().flags,
+              IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN);
+    EXPECT_EQ(IoUring::Setup().coopTaskrun().getParams().flags,
+              IORING_SETUP_COOP_TASKRUN | IORING_SETUP_TASKRUN_FLAG);
+}
+
+static std::optional<IoUring> makeRing(const IoUring::Setup& setup)
+{
+    try
+    {
+        return std::make_optional<IoUring>(setup);
+    }
+    catch (const std::system_error&)
+    {
+        // Unsupported by the kernel or missing privileges
+        return std::nullopt;
+    }
+}
+
+TEST_F(IoUringTest, SetupModes)
+{
+    for (const auto& setup :
+         {IoUring::Setup().sqPoll(std::chrono::milliseconds(10)),
+          IoUring::Setup().coopTaskrun(), IoUring::Setup().deferTaskrun()})
+    {
+        auto r = makeRing(setup);
+        if (!r)
+        {
+            continue;
+        }
+        auto& sqe = r->getSQE();
+        io_uring_prep_nop(&sqe);
+        r->setHandler(sqe, &h[0]);
+        r->submit();
+        r->wait(std::chrono::seconds(5));
+        EXPECT_CALL(h[0], handleCQE(_));
+        r->process();
+        testing::Mock::VerifyAndClearExpectations(&h[0]);
+    }
+}
+
+TEST_F(IoUringTest, DeferTaskrunProcess)
+{
+    auto r = makeRing(IoUring::Setup().deferTaskrun());
+    if (!r)
+    {
+        GTEST_SKIP();
+    }
+
+    // Deferred completions are run by process() without a wait()
+    auto& sqe = r->getSQE();
+    io_uring_prep_nop(&sqe);
+    r->setHandler(sqe, &h[0]);
+    r->submit();
+    EXPECT_CALL(h[0], handleCQE(_));
+    r->process();
+    testing::Mock::VerifyAndClearExpectations(&h[0]);
+}
+
+TEST_F(IoUringTest, SQFull)
+{
+    IoUring r(2);
+    for (size_t i = 0; i < 2; ++i)
+    {
+        io_uring_prep_nop(&r.getSQE());
+    }
+    EXPECT_THROW(r.getSQE(), std::system_error);
+
+    // A full queue is submitted to make room
+    r.setSQFull(IoUring::SQFull::Submit);
+    for (size_t i = 0; i < 6; ++i)
+    {
+        auto& sqe = r.getSQE();
+        io_uring_prep_nop(&sqe);
+        r.setHandler(sqe, &h[0]);
+    }
+    r.submit();
+    EXPECT_CALL(h[0], handleCQE(_)).Times(6);
+    // The NOPs without a handler aren't counted
+    EXPECT_EQ(r.process(10), 6);
+    testing::Mock::VerifyAndClearExpectations(&h[0]);
+
+    // Completions can be handled while making room
+    r.setSQFull(IoUring::SQFull::SubmitProcess);
+    EXPECT_CALL(h[1], handleCQE(_)).Times(2);
+    for (size_t i = 0; i < 3; ++i)
+    {
+        auto& sqe = r.getSQE();
+        io_uring_prep_nop(&sqe);
+        r.setHandler(sqe, &h[1]);
+    }
+    testing::Mock::VerifyAndClearExpectations(&h[1]);
+    r.submit();
+    EXPECT_CALL(h[1], handleCQE(_));
+    r.process();
+    testing::Mock::VerifyAndClearExpectations(&h[1]);
+}
+
+struct Requeue : IoUring::CQEHandler
+{
+    Requeue(IoUring& ring, size_t remaining) : ring(ring), remaining(remaining)
+    {}
+
+    void handleCQE(io_uring_cqe&) noexcept override
+    {
+        calls++;
+        for (size_t i = 0; i < 2 && remaining > 0; ++i, --remaining)
+        {
+            auto& sqe = ring.getSQE();
+            io_uring_prep_nop(&sqe);
+            ring.setHandler(sqe, this);
+        }
+    }
+
+    IoUring& ring;
+    size_t remaining;
+    size_t calls = 0;
+};
+
+TEST_F(IoUringTest, SQFullInHandler)
+{
+    // Handlers filling the queue must not reap the CQEs of the batch being
+    // processed a second time
+    IoUring r(2);
+    r.setSQFull(IoUring::SQFull::SubmitProcess);
+    Requeue h(r, 20);
+    for (size_t i = 0; i < 2; ++i)
+    {
+        auto& sqe = r.getSQE();
+        io_uring_prep_nop(&sqe);
+        r.setHandler(sqe, &h);
+    }
+    r.runUntil([&]() { return h.calls >= 22; }, 1, std::chrono::seconds(5));
+    EXPECT_EQ(22, h.calls);
+    EXPECT_EQ(0, h.remaining);
+    r.submitAndWait(0);
+    EXPECT_EQ(0, r.process(10));
+}
+
+TEST_F(IoUringTest, SubmitAndWait)
+{
+    auto& sqe = ring.getSQE();
+    io_uring_prep_nop(&sqe);
+    ring.setHandler(sqe, &h[0]);
+    ring.submitAndWait();
+    EXPECT_CALL(h[0], handleCQE(_));
+    EXPECT_EQ(1, ring.process(10));
+    testing::Mock::VerifyAndClearExpectations(&h[0]);
+}
+
+TEST_F(IoUringTest, SubmitAndWaitTimeout)
+{
+    // Timing out is not an error
+    auto kts = chronoToKTS(std::chrono::seconds(10));
+    {
+        auto& sqe = ring.getSQE();
+        io_uring_prep_timeout(&sqe, &kts, 0, 0);
+        ring.setHandler(sqe, &h[0]);
+    }
+    ring.submitAndWait(1, std::chrono::milliseconds(1));
+    EXPECT_EQ(0, ring.process(10));
+
+    // Completions that arrive before the timeout are left for process()
+    auto short_kts = chronoToKTS(std::chrono::milliseconds(1));
+    {
+        auto& sqe = ring.getSQE();
+        io_uring_prep_timeout(&sqe, &short_kts, 0, 0);
+        ring.setHandler(sqe, &h[1]);
+    }
+    ring.submitAndWait(1, std::chrono::seconds(5));
+    EXPECT_CALL(h[1], handleCQE(_));
+    EXPECT_EQ(1, ring.process(10));
+    testing::Mock::VerifyAndClearExpectations(&h[1]);
+
+    EXPECT_CALL(h[0], handleCQE(_));
+}
+
+TEST_F(IoUringTest, RunUntil)
+{
+    size_t handled = 0;
+    std::array kts = {chronoToKTS(std::chrono::milliseconds(1)),
+                      chronoToKTS(std::chrono::milliseconds(2))};
+    for (size_t i = 0; i < kts.size(); ++i)
+    {
+        auto& sqe = ring.getSQE();
+        io_uring_prep_timeout(&sqe, &kts[i], 0, 0);
+        ring.setHandler(sqe, &h[i]);
+        EXPECT_CALL(h[i], handleCQE(_)).WillOnce([&](io_uring_cqe&) {
+            handled++;
+        });
+    }
+    ring.runUntil([&]() { return handled == kts.size(); }, 2,
+                  std::chrono::seconds(5));
+}
+
+TEST_F(IoUringTest, MsgRing)
+{
+    IoUring target;
+    ring.msgRing(target, 42);
+    ring.submit();
+    target.wait(std::chrono::seconds(5));
+    // Messages are dropped without a handler
+    EXPECT_EQ(0, target.process(10));
+
+    target.setMsgHandler(&h[0]);
+    ring.msgRing(target, 42);
+    ring.submit();
+    target.wait(std::chrono::seconds(5));
+    EXPECT_CALL(h[0], handleCQE(_)).WillOnce([](io_uring_cqe& cqe) {
+        EXPECT_EQ(42, cqe.res);
+    });
+    EXPECT_EQ(1, target.process(10));
+    testing::Mock::VerifyAndClearExpectations(&h[0]);
+    ring.process();
+}
+
+TEST_F(IoUringTest, Stats)
+{
+    EXPECT_EQ(nullptr, ring.getStats());
+    ring.enableStats();
+
+    // Replacing the handler cancels the original one
+    EXPECT_CALL(h[0], handleCQE(_)).Times(1);
+    for (size_t i = 0; i < 3; ++i)
+    {
+        auto& sqe = ring.getSQE();
+        io_uring_prep_nop(&sqe);
+        ring.setHandler(sqe, &h[0]);
+        if (i == 0)
+        {
+            ring.setHandler(sqe, &h[1]);
+        }
+    }
+    io_uring_prep_nop(&ring.getSQE());
+    auto kts = chronoToKTS(std::chrono::milliseconds(1));
+    {
+        auto& sqe = ring.getSQE();
+        io_uring_prep_timeout(&sqe, &kts, 0, 0);
+        ring.setHandler(sqe, &h[0]);
+    }
+    ring.submit();
+    testing::Mock::VerifyAndClearExpectations(&h[0]);
+
+    auto stats = ring.getStats();
+    ASSERT_NE(nullptr, stats);
+    EXPECT_EQ(5, stats->submitted);
+    EXPECT_EQ(4, stats->ops[IORING_OP_NOP]);
+    EXPECT_EQ(1, stats->ops[IORING_OP_TIMEOUT]);
+    EXPECT_EQ(1, stats->replaced);
+
+    EXPECT_CALL(h[0], handleCQE(_)).Times(3);
+    EXPECT_CALL(h[1], handleCQE(_)).Times(1);
+    ring.runUntil([&]() { return stats->inflight() == 0; });
+    testing::Mock::VerifyAndClearExpectations(&h[0]);
+    testing::Mock::VerifyAndClearExpectations(&h[1]);
+
+    stats = ring.getStats();
+    EXPECT_EQ(5, stats->completed);
+    EXPECT_EQ(5, stats->cqes);
+    EXPECT_EQ(1, stats->unhandled);
+    EXPECT_EQ(0, stats->overflows);
+    EXPECT_EQ(0, stats->dropped);
+    uint64_t timed = 0;
+    for (auto n : stats->latency)
+    {
+        timed += n;
+    }
+    EXPECT_EQ(4, timed);
+    // The timeout takes at least 1ms
+    timed = 0;
+    for (size_t i = 10; i < stats->latency.size(); ++i)
+    {
+        timed += stats->latency[i];
+    }
+    EXPECT_GE(timed, 1);
+
+    char* buf = nullptr;
+    size_t size = 0;
+    auto stream = open_memstream(&buf, &size);
+    ASSERT_NE(nullptr, stream);
+    stats->dump(stream);
+    fclose(stream);
+    std::string_view out(buf, size);
+    EXPECT_NE(out.find("submitted=5 completed=5 inflight=0"), out.npos);
+    EXPECT_NE(out.find(fmt::format("op {}: 4", int(IORING_OP_NOP))),
+              out.npos);
+    free(buf);
+
+    ring.enableStats(false);
+    EXPECT_EQ(nullptr, ring.getStats());
+}
+
+TEST_F(IoUringTest, ProcessBounded)
+{
+    for (size_t i = 0; i < 5; ++i)
+    {
+        auto& sqe = ring.getSQE();
+        io_uring_prep_nop(&sqe);
+        ring.setHandler(sqe, &h[i % 2]);
+    }
+    ring.submit();
+
+    EXPECT_CALL(h[0], handleCQE(_));
+    EXPECT_CALL(h[1], handleCQE(_));
+    EXPECT_EQ(2, ring.process(2));
+    testing::Mock::VerifyAndClearExpectations(&h[0]);
+    testing::Mock::VerifyAndClearExpectations(&h[1]);
+
+    EXPECT_CALL(h[0], handleCQE(_)).Times(2);
+    EXPECT_CALL(h[1], handleCQE(_));
+    EXPECT_EQ(3, ring.process(10));
+    testing::Mock::VerifyAndClearExpectations(&h[0]);
+    testing::Mock::VerifyAndClearExpectations(&h[1]);
+
+    EXPECT_EQ(0, ring.process(10));
+}
+
+TEST_F(IoUringTest, HandlerShared)
+{
+    for (size_t i = 0; i < 3; ++i)
+    {
+        auto& sqe = ring.getSQE();
+        io_uring_prep_nop(&sqe);
+        ring.setHandler(sqe, &h[0]);
+    }
+    {
+        auto& sqe = ring.getSQE();
+        io_uring_prep_nop(&sqe);
+        ring.setHandler(sqe, &h[1]);
+    }
+
+    // Every SQE referencing the handler should produce a callback
+    ring.submit();
+    EXPECT_CALL(h[0], handleCQE(_)).Times(3);
+    EXPECT_CALL(h[1], handleCQE(_));
+    ring.process();
+    testing::Mock::VerifyAndClearExpectations(&h[0]);
+    testing::Mock::VerifyAndClearExpectations(&h[1]);
+
+    // Outstanding references are all cancelled on destruction
+    for (size_t i = 0; i < 2; ++i)
+    {
+        auto& sqe = ring.getSQE();
+        io_uring_prep_nop(&sqe);
+        ring.setHandler(sqe, &h[1]);
+    }
+    EXPECT_CALL(h[1], handleCQE(_)).Times(2);
+}
+
+TEST_F(IoUringTest, HandlerManyOutstanding)
+{
+    constexpr size_t num = 64;
+    IoUring bigring(num);
+    std::vector<testing::StrictMock<MockHandler>> hs(num * 2);
+    std::vector<size_t> order;
+    for (size_t i = 0; i < hs.size(); ++i)
+    {
+        EXPECT_CALL(hs[i], handleCQE(_)).WillOnce([&, i](io_uring_cqe& cqe) {
+            EXPECT_EQ(cqe.res, -ETIME);
+            order.push_back(i);
+        });
+    }
+
+    // Complete handlers in a different order than they were registered in
+    // so that the handler table is shuffled as entries are removed.
+    std::array kts = {chronoToKTS(std::chrono::milliseconds(20)),
+                      chronoToKTS(std::chrono::milliseconds(1))};
+    for (size_t i = 0; i < hs.size(); ++i)
+    {
+        auto& sqe = bigring.getSQE();
+        io_uring_prep_timeout(&sqe, &kts[i % 2], 0, 0);
+        bigring.setHandler(sqe, &hs[i]);
+        if (i % num == num - 1)
+        {
+            bigring.submit();
+        }
+    }
+    while (order.size() < hs.size())
+    {
+        bigring.wait();
+        bigring.process();
+    }
+    std::sort(order.begin(), order.end());
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        EXPECT_EQ(order[i], i);
+    }
+}
+
 TEST_F(IoUringTest, EventFd)
 {
     auto& efd = ring.getEventFd();
@@ -213,6 +632,56 @@ TEST_F(IoUringTest, EventFd)
     ASSERT_EQ(0, poll(&pfd, 1, 100));
 }
 
+class ResubmitHandler : public IoUring::CQEHandler
+{
+  public:
+    ResubmitHandler(IoUring& ring, size_t left) : ring(ring), left(left) {}
+
+    void handleCQE(io_uring_cqe&) noexcept override
+    {
+        handled++;
+        if (left > 0)
+        {
+            left--;
+            auto& sqe = ring.getSQE();
+            io_uring_prep_nop(&sqe);
+            ring.setHandler(sqe, this);
+            ring.submit();
+        }
+    }
+
+    IoUring& ring;
+    size_t left;
+    size_t handled = 0;
+};
+
+TEST_F(IoUringTest, EventFdEpoll)
+{
+    ManagedFd epfd(CHECK_ERRNO(epoll_create1(0), "epoll_create1"));
+    ring.registerEpoll(epfd.get(), 42);
+
+    // Completions posted while draining don't signal the event loop again
+    ResubmitHandler rh(ring, 3);
+    auto& sqe = ring.getSQE();
+    io_uring_prep_nop(&sqe);
+    ring.setHandler(sqe, &rh);
+    ring.submit();
+
+    epoll_event ev;
+    ASSERT_EQ(1, epoll_wait(epfd.get(), &ev, 1, 100));
+    EXPECT_EQ(42, ev.data.u64);
+    ring.processEvents();
+    EXPECT_EQ(4, rh.handled);
+    EXPECT_EQ(0, epoll_wait(epfd.get(), &ev, 1, 0));
+
+    // Notifications are enabled again after processing
+    io_uring_prep_nop(&ring.getSQE());
+    ring.submit();
+    ASSERT_EQ(1, epoll_wait(epfd.get(), &ev, 1, 100));
+    ring.processEvents();
+    EXPECT_EQ(0, epoll_wait(epfd.get(), &ev, 1, 0));
+}
+
 TEST_F(IoUringTest, Wait)
 {
     auto& sqe = ring.getSQE();
@@ -283,6 +752,735 @@ TEST_F(IoUringTest, RegisterFiles)
     fhs.emplace_back(ring.registerFile(STDERR_FILENO));
     testFdWrite(fhs.back(), IOSQE_FIXED_FILE);
     EXPECT_GE(ring.getFiles().size(), 10);
+
+    // Growing the table keeps the existing registrations
+    testFdWrite(fhs.front(), IOSQE_FIXED_FILE);
+}
+
+TEST_F(IoUringTest, RegisterFilesChurn)
+{
+    if (!checkKernelSafe(5, 10))
+    {
+        GTEST_SKIP();
+    }
+
+    ring.reserveFiles(4);
+    auto size = ring.getFiles().size();
+    std::vector<IoUring::FileHandle> fhs;
+    for (size_t i = 0; i < 1000; ++i)
+    {
+        fhs.emplace_back(ring.registerFile(STDERR_FILENO));
+        if (fhs.size() == 3)
+        {
+            fhs.erase(fhs.begin());
+        }
+    }
+
+    // Released slots are recycled without growing the table
+    EXPECT_EQ(ring.getFiles().size(), size);
+    EXPECT_EQ(std::count(ring.getFiles().begin(), ring.getFiles().end(),
+                         STDERR_FILENO),
+              2);
+    testFdWrite(fhs.back(), IOSQE_FIXED_FILE);
+}
+
+TEST_F(IoUringTest, RegisterFilesGrowFailure)
+{
+    if (!checkKernelSafe(5, 10))
+    {
+        GTEST_SKIP();
+    }
+
+    rlimit lim;
+    CHECK_ERRNO(getrlimit(RLIMIT_NOFILE, &lim), "getrlimit");
+    if (lim.rlim_cur > (1 << 20))
+    {
+        GTEST_SKIP();
+    }
+    auto fh = ring.registerFile(STDERR_FILENO);
+    auto size = ring.getFiles().size();
+
+    // The kernel refuses tables larger than the open file limit, the
+    // existing table must survive the failed attempt
+    EXPECT_THROW(ring.reserveFiles(lim.rlim_cur + 1), std::system_error);
+    EXPECT_EQ(size, ring.getFiles().size());
+    testFdWrite(fh, IOSQE_FIXED_FILE);
+    auto fh2 = ring.registerFile(STDERR_FILENO);
+    EXPECT_EQ(1, fh2);
+    testFdWrite(fh2, IOSQE_FIXED_FILE);
+}
+
+struct Task
+{
+    struct promise_type
+    {
+        Task get_return_object() noexcept
+        {
+            return {};
+        }
+        std::suspend_never initial_suspend() noexcept
+        {
+            return {};
+        }
+        std::suspend_never final_suspend() noexcept
+        {
+            return {};
+        }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept
+        {
+            std::terminate();
+        }
+    };
+};
+
+static void runUntil(IoUring& ring, const bool& done)
+{
+    ring.runUntil([&]() { return done; });
+}
+
+static Task coTimeout(IoUring& ring, bool& done)
+{
+    co_await ring.timeout(std::chrono::milliseconds(1));
+    done = true;
+}
+
+static Task coPipe(IoUring& ring, int rfd, int wfd, std::string& out,
+                   bool& done)
+{
+    std::string_view data = "Hello";
+    auto w = co_await ring.write(wfd, raw::asSpan<std::byte>(data));
+    EXPECT_EQ(w.size(), data.size());
+    std::array<char, 16> buf;
+    auto r = co_await ring.read(rfd, raw::asSpan<std::byte>(buf));
+    out.assign(reinterpret_cast<char*>(r.data()), r.size());
+    done = true;
+}
+
+static Task coReadEof(IoUring& ring, int rfd, bool& eof, bool& done)
+{
+    std::array<std::byte, 16> buf;
+    try
+    {
+        co_await ring.read(rfd, buf);
+    }
+    catch (const exception::Eof&)
+    {
+        eof = true;
+    }
+    done = true;
+}
+
+static Task coAccept(IoUring& ring, int lfd, SockAddrBuf& addr,
+                     std::optional<DupableFd>& conn, bool& done)
+{
+    conn.emplace(co_await ring.accept(lfd, addr));
+    done = true;
+}
+
+static Task coCancelled(IoUring& ring, int& err)
+{
+    try
+    {
+        co_await ring.timeout(std::chrono::seconds(10));
+    }
+    catch (const std::system_error& e)
+    {
+        err = e.code().value();
+    }
+}
+
+static Task coFixed(IoUring& ring, int rfd, int wfd,
+                    const IoUring::BufferHandle& wbuf,
+                    const IoUring::BufferHandle& rbuf, std::string& out,
+                    bool& done)
+{
+    std::string_view data = "Fixed";
+    std::copy_n(reinterpret_cast<const std::byte*>(data.data()), data.size(),
+                wbuf.get().begin());
+    auto w = co_await ring.writeFixed(wfd, wbuf,
+                                      wbuf.get().subspan(0, data.size()));
+    EXPECT_EQ(w.size(), data.size());
+    auto r = co_await ring.readFixed(rfd, rbuf);
+    EXPECT_EQ(r.data(), rbuf.get().data());
+    out.assign(reinterpret_cast<char*>(r.data()), r.size());
+    done = true;
+}
+
+static Task coFile(IoUring& ring, bool& done)
+{
+    const char* dir = std::getenv("TMPDIR");
+    auto fd = co_await ring.openat(
+        dir != nullptr ? dir : "/tmp",
+        fd::OpenFlags(fd::OpenAccess::ReadWrite).set(fd::OpenFlag::TmpFile),
+        0600);
+    std::string_view data = "Hello world";
+    auto w = co_await ring.writeExact(fd.get(), raw::asSpan<std::byte>(data),
+                                      0);
+    EXPECT_EQ(w.size(), data.size());
+    co_await ring.fsync(fd.get(), /*datasync=*/true);
+
+    struct statx st;
+    auto& sr = co_await ring.statx("", st, AT_EMPTY_PATH, STATX_SIZE,
+                                   fd.get());
+    EXPECT_EQ(&sr, &st);
+    EXPECT_EQ(st.stx_size, data.size());
+
+    std::array<char, 5> buf;
+    co_await ring.readExact(fd.get(), raw::asSpan<std::byte>(buf), 6);
+    EXPECT_EQ(std::string_view(buf.data(), buf.size()), "world");
+    EXPECT_THROW(co_await ring.readExact(fd.get(),
+                                         raw::asSpan<std::byte>(buf), 8),
+                 exception::Incomplete);
+    EXPECT_THROW(co_await ring.readExact(fd.get(),
+                                         raw::asSpan<std::byte>(buf), 11),
+                 exception::Eof);
+
+    std::string all;
+    co_await ring.readAll(fd.get(), all, 0);
+    EXPECT_EQ(all, data);
+    std::vector<uint32_t> words;
+    EXPECT_THROW(co_await ring.readAll(fd.get(), words, 0),
+                 exception::Incomplete);
+    EXPECT_THROW(co_await ring.fsync(-1), std::system_error);
+    done = true;
+}
+
+static Task coReadExact(IoUring& ring, int rfd, std::string& out, bool& done)
+{
+    std::array<char, 4> buf;
+    auto r = co_await ring.readExact(rfd, raw::asSpan<std::byte>(buf));
+    out.assign(reinterpret_cast<char*>(r.data()), r.size());
+    done = true;
+}
+
+static Task coReadAll(IoUring& ring, int rfd, std::string& out, bool& done)
+{
+    co_await ring.readAll(rfd, out);
+    done = true;
+}
+
+/** @brief A container which fails to grow past a limit */
+struct LimitedBuf
+{
+    std::vector<char> buf;
+    size_t limit;
+
+    char* data() noexcept
+    {
+        return buf.data();
+    }
+    size_t size() const noexcept
+    {
+        return buf.size();
+    }
+    void resize(size_t size)
+    {
+        if (size > limit)
+        {
+            throw std::length_error("LimitedBuf");
+        }
+        buf.resize(size);
+    }
+};
+
+static Task coReadAllLimited(IoUring& ring, int rfd, LimitedBuf& buf,
+                             bool& done)
+{
+    // The failure is passed through as is, not as an errno
+    EXPECT_THROW(co_await ring.readAll(rfd, buf), std::length_error);
+    done = true;
+}
+
+TEST_F(IoUringTest, CoroutinePrepFailure)
+{
+    std::array<int, 2> fds;
+    ASSERT_EQ(0, pipe(fds.data()));
+    ManagedFd rfd(std::move(fds[0])), wfd(std::move(fds[1]));
+    fd::writeExact(wfd, std::string(1024, 'x'));
+
+    // Growing the container fails after its SQE was taken, which must not
+    // be submitted as a stale read
+    ring.enableStats();
+    bool done = false;
+    LimitedBuf buf{{}, 300};
+    coReadAllLimited(ring, rfd.get(), buf, done);
+    runUntil(ring, done);
+    EXPECT_EQ(256, buf.size());
+    ring.submit();
+    EXPECT_EQ(1, ring.getStats()->ops[IORING_OP_READ]);
+    EXPECT_EQ(1, ring.getStats()->ops[IORING_OP_NOP]);
+
+    std::array<char, 1024> rest;
+    EXPECT_EQ(768, ::read(rfd.get(), rest.data(), rest.size()));
+}
+
+TEST_F(IoUringTest, WriteExactNoProgress)
+{
+    // A write taking nothing is never retried, nothing here would block
+    std::array<std::byte, 4> data = {};
+    IoUring::WriteExactOp op{-1, data, 0};
+    io_uring_cqe cqe{};
+    EXPECT_FALSE(op.resubmit(cqe));
+    EXPECT_THROW(op.finish(cqe), exception::Incomplete);
+}
+
+TEST_F(IoUringTest, CoroutineFile)
+{
+    bool done = false;
+    coFile(ring, done);
+    runUntil(ring, done);
+}
+
+TEST_F(IoUringTest, CoroutineShortIO)
+{
+    std::array<int, 2> fds;
+    ASSERT_EQ(0, pipe(fds.data()));
+    ManagedFd rfd(std::move(fds[0])), wfd(std::move(fds[1]));
+
+    // Short reads are resubmitted until the buffer is full
+    bool done = false;
+    std::string out;
+    fd::writeExact(wfd, std::string_view("ab"));
+    coReadExact(ring, rfd.get(), out, done);
+    ring.submit();
+    ring.wait();
+    ring.process();
+    EXPECT_FALSE(done);
+    fd::writeExact(wfd, std::string_view("cd"));
+    runUntil(ring, done);
+    EXPECT_EQ(out, "abcd");
+
+    // Large streams grow the container until the end of the file
+    done = false;
+    out.clear();
+    coReadAll(ring, rfd.get(), out, done);
+    std::string data(4096, 'x');
+    fd::writeExact(wfd, data);
+    wfd = ManagedFd();
+    runUntil(ring, done);
+    EXPECT_EQ(out, data);
+}
+
+TEST_F(IoUringTest, CoroutineTimeout)
+{
+    bool done = false;
+    coTimeout(ring, done);
+    EXPECT_FALSE(done);
+    runUntil(ring, done);
+}
+
+TEST_F(IoUringTest, CoroutineReadWrite)
+{
+    std::array<int, 2> fds;
+    ASSERT_EQ(0, pipe(fds.data()));
+    ManagedFd rfd(std::move(fds[0])), wfd(std::move(fds[1]));
+
+    bool done = false;
+    std::string out;
+    coPipe(ring, rfd.get(), wfd.get(), out, done);
+    runUntil(ring, done);
+    EXPECT_EQ(out, "Hello");
+
+    bool eof = false;
+    done = false;
+    coReadEof(ring, rfd.get(), eof, done);
+    wfd = ManagedFd();
+    runUntil(ring, done);
+    EXPECT_TRUE(eof);
+}
+
+TEST_F(IoUringTest, CoroutineAccept)
+{
+    ManagedFd lfd(CHECK_ERRNO(socket(AF_INET, SOCK_STREAM, 0), "socket"));
+    sockaddr_in sin = {};
+    sin.sin_family = AF_INET;
+    sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    fd::bind(lfd, sin);
+    fd::listen(lfd, 1);
+    socklen_t len = sizeof(sin);
+    CHECK_ERRNO(getsockname(lfd.get(), reinterpret_cast<sockaddr*>(&sin), &len),
+                "getsockname");
+
+    bool done = false;
+    SockAddrBuf addr = {};
+    std::optional<DupableFd> conn;
+    coAccept(ring, lfd.get(), addr, conn, done);
+    ring.submit();
+
+    ManagedFd cfd(CHECK_ERRNO(socket(AF_INET, SOCK_STREAM, 0), "socket"));
+    fd::connect(cfd, sin);
+    runUntil(ring, done);
+    ASSERT_TRUE(conn);
+    EXPECT_TRUE(*conn);
+    EXPECT_EQ(addr.fam, AF_INET);
+    EXPECT_EQ(addr.len, sizeof(sockaddr_in));
+}
+
+TEST_F(IoUringTest, FixedBuffers)
+{
+    EXPECT_THROW(ring.getBuffer(), std::system_error);
+    ring.registerBuffers(2, 64);
+
+    // Buffers are handed out until the slab is exhausted
+    std::optional<IoUring::BufferHandle> b0 = ring.getBuffer();
+    std::optional<IoUring::BufferHandle> b1 = ring.getBuffer();
+    EXPECT_EQ(b0->index(), 0);
+    EXPECT_EQ(b1->index(), 1);
+    EXPECT_EQ(b0->get().size(), 64);
+    EXPECT_EQ(b0->get().data() + 64, b1->get().data());
+    EXPECT_THROW(ring.getBuffer(), std::system_error);
+
+    // Can't replace the slab while it is in use
+    EXPECT_THROW(ring.registerBuffers(4, 64), std::system_error);
+
+    // Released buffers are reused
+    b0.reset();
+    b0 = ring.getBuffer();
+    EXPECT_EQ(b0->index(), 0);
+
+    std::array<int, 2> fds;
+    ASSERT_EQ(0, pipe(fds.data()));
+    ManagedFd rfd(std::move(fds[0])), wfd(std::move(fds[1]));
+    bool done = false;
+    std::string out;
+    coFixed(ring, rfd.get(), wfd.get(), *b0, *b1, out, done);
+    runUntil(ring, done);
+    EXPECT_EQ(out, "Fixed");
+
+    b0.reset();
+    b1.reset();
+    ring.registerBuffers(4, 64);
+    EXPECT_EQ(ring.getBuffer().index(), 0);
+}
+
+class RecvHandler : public IoUring::BufferHandler
+{
+  public:
+    using IoUring::BufferHandler::BufferHandler;
+
+    std::vector<std::string> chunks;
+    bool more = true;
+
+    void handleBuffer(io_uring_cqe& cqe,
+                      std::span<std::byte> data) noexcept override
+    {
+        EXPECT_GE(cqe.res, 0);
+        more = cqe.flags & IORING_CQE_F_MORE;
+        if (data.size() > 0)
+        {
+            chunks.emplace_back(reinterpret_cast<char*>(data.data()),
+                                data.size());
+        }
+    }
+};
+
+TEST_F(IoUringTest, RecvMultishot)
+{
+    if (!checkKernelSafe(6, 0))
+    {
+        GTEST_SKIP();
+    }
+
+    std::array<int, 2> fds;
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds.data()));
+    ManagedFd rfd(std::move(fds[0])), wfd(std::move(fds[1]));
+
+    // Fewer buffers than messages to ensure they are recycled
+    IoUring::BufferRing bufs(ring, 1, 2, 16);
+    RecvHandler rh(bufs);
+    ring.recvMultishot(rfd.get(), rh);
+    ring.submit();
+
+    for (size_t i = 0; i < 5; ++i)
+    {
+        auto msg = fmt::format("msg{}", i);
+        fd::writeExact(wfd, msg);
+        while (rh.chunks.size() <= i)
+        {
+            ring.wait(std::chrono::seconds(5));
+            ring.process();
+        }
+        EXPECT_EQ(rh.chunks[i], msg);
+        EXPECT_TRUE(rh.more);
+    }
+
+    // Closing the peer terminates the request
+    wfd = ManagedFd();
+    while (rh.more)
+    {
+        ring.wait(std::chrono::seconds(5));
+        ring.process();
+    }
+    EXPECT_EQ(rh.chunks.size(), 5);
+}
+
+class AcceptHandler : public IoUring::CQEHandler
+{
+  public:
+    std::vector<ManagedFd> conns;
+    int last = 0;
+    bool more = true;
+
+    void handleCQE(io_uring_cqe& cqe) noexcept override
+    {
+        more = cqe.flags & IORING_CQE_F_MORE;
+        last = cqe.res;
+        if (cqe.res >= 0)
+        {
+            conns.emplace_back(std::move(cqe.res));
+        }
+    }
+};
+
+TEST_F(IoUringTest, AcceptMultishot)
+{
+    if (!checkKernelSafe(5, 19))
+    {
+        GTEST_SKIP();
+    }
+
+    ManagedFd lfd(CHECK_ERRNO(socket(AF_INET, SOCK_STREAM, 0), "socket"));
+    sockaddr_in sin = {};
+    sin.sin_family = AF_INET;
+    sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    fd::bind(lfd, sin);
+    fd::listen(lfd, 2);
+    socklen_t len = sizeof(sin);
+    CHECK_ERRNO(getsockname(lfd.get(), reinterpret_cast<sockaddr*>(&sin), &len),
+                "getsockname");
+
+    AcceptHandler ah;
+    ring.acceptMultishot(lfd.get(), ah);
+    ring.submit();
+
+    std::vector<ManagedFd> clients;
+    for (size_t i = 0; i < 2; ++i)
+    {
+        clients.emplace_back(
+            CHECK_ERRNO(socket(AF_INET, SOCK_STREAM, 0), "socket"));
+        fd::connect(clients.back(), sin);
+        while (ah.conns.size() <= i)
+        {
+            ring.wait(std::chrono::seconds(5));
+            ring.process();
+        }
+        EXPECT_TRUE(ah.more);
+    }
+
+    ring.cancelHandler(ah);
+    while (ah.more)
+    {
+        ring.wait(std::chrono::seconds(5));
+        ring.process();
+    }
+    EXPECT_EQ(ah.last, -ECANCELED);
+    EXPECT_EQ(ah.conns.size(), 2);
+}
+
+class SendZCHandler : public IoUring::SendZCHandler
+{
+  public:
+    std::vector<std::byte> data;
+    std::vector<int32_t> sent;
+    std::vector<bool> released;
+
+    void handleSent(io_uring_cqe& cqe) noexcept override
+    {
+        // The data must still be alive at this point
+        EXPECT_FALSE(data.empty());
+        sent.push_back(cqe.res);
+    }
+
+    void handleRelease(bool copied) noexcept override
+    {
+        EXPECT_EQ(sent.size(), released.size() + 1);
+        released.push_back(copied);
+        data.clear();
+    }
+};
+
+TEST_F(IoUringTest, SendZC)
+{
+    if (!checkKernelSafe(6, 2))
+    {
+        GTEST_SKIP();
+    }
+
+    ManagedFd rfd(CHECK_ERRNO(socket(AF_INET, SOCK_DGRAM, 0), "socket"));
+    sockaddr_in sin = {};
+    sin.sin_family = AF_INET;
+    sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    fd::bind(rfd, sin);
+    socklen_t len = sizeof(sin);
+    CHECK_ERRNO(getsockname(rfd.get(), reinterpret_cast<sockaddr*>(&sin), &len),
+                "getsockname");
+    ManagedFd wfd(CHECK_ERRNO(socket(AF_INET, SOCK_DGRAM, 0), "socket"));
+    fd::connect(wfd, sin);
+
+    SendZCHandler zh;
+    zh.data.resize(1024, std::byte{'a'});
+    ring.sendZC(wfd.get(), zh.data, zh, {}, true);
+    ring.submit();
+    while (zh.released.empty())
+    {
+        ring.wait(std::chrono::seconds(5));
+        ring.process();
+    }
+    EXPECT_THAT(zh.sent, testing::ElementsAre(1024));
+    // Loopback traffic is always copied
+    EXPECT_THAT(zh.released, testing::ElementsAre(true));
+
+    std::array<std::byte, 2048> buf;
+    EXPECT_EQ(fd::read(rfd, buf).size(), 1024);
+
+    // Without the usage report the copy is never flagged
+    zh.data.resize(1024, std::byte{'a'});
+    ring.sendZC(wfd.get(), zh.data, zh);
+    ring.submit();
+    while (zh.released.size() < 2)
+    {
+        ring.wait(std::chrono::seconds(5));
+        ring.process();
+    }
+    EXPECT_THAT(zh.sent, testing::ElementsAre(1024, 1024));
+    EXPECT_THAT(zh.released, testing::ElementsAre(true, false));
+    EXPECT_EQ(fd::read(rfd, buf).size(), 1024);
+
+    // Errors don't reference the data and release it immediately
+    zh.data.resize(16);
+    ring.sendZC(-1, zh.data, zh);
+    ring.submit();
+    while (zh.released.size() < 3)
+    {
+        ring.wait(std::chrono::seconds(5));
+        ring.process();
+    }
+    EXPECT_EQ(zh.sent[2], -EBADF);
+}
+
+TEST_F(IoUringTest, SendZCCancelledOnDestroy)
+{
+    SendZCHandler zh;
+    {
+        IoUring r;
+        zh.data.resize(16);
+        r.sendZC(-1, zh.data, zh);
+    }
+    EXPECT_THAT(zh.sent, testing::ElementsAre(-ECANCELED));
+    EXPECT_THAT(zh.released, testing::ElementsAre(false));
+}
+
+TEST_F(IoUringTest, CoroutineCancelledOnDestroy)
+{
+    int err = 0;
+    {
+        IoUring r;
+        coCancelled(r, err);
+        r.submit();
+    }
+    EXPECT_EQ(err, ECANCELED);
+}
+
+class TestChain : public IoUring::Chain
+{
+  public:
+    using Chain::Chain;
+
+    std::optional<std::vector<int32_t>> res;
+
+    void handleChain(std::span<const int32_t> r) noexcept override
+    {
+        res.emplace(r.begin(), r.end());
+    }
+};
+
+static void runUntil(IoUring& ring, const TestChain& c)
+{
+    ring.runUntil([&]() { return c.res.has_value(); }, 1,
+                  std::chrono::seconds(5));
+}
+
+TEST_F(IoUringTest, ChainCopy)
+{
+    std::array<int, 2> fds;
+    ASSERT_EQ(0, pipe(fds.data()));
+    ManagedFd rfd(std::move(fds[0])), wfd(std::move(fds[1]));
+
+    TestChain c(ring);
+    std::string_view data = "Chain";
+    std::array<char, 16> buf;
+    io_uring_prep_write(&c.add(), wfd.get(), data.data(), data.size(), 0);
+    io_uring_prep_read(&c.add(std::chrono::seconds(5)), rfd.get(),
+                       buf.data(), buf.size(), 0);
+    c.queue();
+    EXPECT_THROW(c.add(), std::system_error);
+    runUntil(ring, c);
+    EXPECT_THAT(*c.res, testing::ElementsAre(5, 5));
+    EXPECT_EQ(std::string_view(buf.data(), 5), data);
+
+    // The chain is reusable once handled
+    c.res.reset();
+    io_uring_prep_nop(&c.add());
+    c.queue();
+    runUntil(ring, c);
+    EXPECT_THAT(*c.res, testing::ElementsAre(0));
+}
+
+TEST_F(IoUringTest, ChainFailure)
+{
+    TestChain c(ring);
+    std::array<char, 16> buf;
+    io_uring_prep_read(&c.add(), -1, buf.data(), buf.size(), 0);
+    io_uring_prep_nop(&c.add());
+    c.queue();
+    runUntil(ring, c);
+    EXPECT_THAT(*c.res, testing::ElementsAre(-EBADF, -ECANCELED));
+}
+
+TEST_F(IoUringTest, ChainDeadline)
+{
+    std::array<int, 2> fds;
+    ASSERT_EQ(0, pipe(fds.data()));
+    ManagedFd rfd(std::move(fds[0])), wfd(std::move(fds[1]));
+
+    TestChain c(ring);
+    std::array<char, 16> buf;
+    io_uring_prep_nop(&c.add(std::chrono::seconds(5)));
+    io_uring_prep_read(&c.add(std::chrono::milliseconds(1)), rfd.get(),
+                       buf.data(), buf.size(), 0);
+    io_uring_prep_nop(&c.add());
+    c.queue();
+    runUntil(ring, c);
+    EXPECT_THAT(*c.res, testing::ElementsAre(0, -ETIME, -ECANCELED));
+}
+
+TEST_F(IoUringTest, ChainTooLong)
+{
+    IoUring r(2);
+    TestChain c(r);
+    io_uring_prep_nop(&c.add(std::chrono::seconds(1)));
+    // The request added so far is still sent and handled
+    EXPECT_THROW(c.add(), std::system_error);
+    EXPECT_THROW(c.queue(), std::system_error);
+    runUntil(r, c);
+    EXPECT_THAT(*c.res, testing::ElementsAre(0));
+
+    c.res.reset();
+    io_uring_prep_nop(&c.add());
+    io_uring_prep_nop(&c.add());
+    EXPECT_THROW(c.add(), std::system_error);
+    runUntil(r, c);
+    EXPECT_THAT(*c.res, testing::ElementsAre(0, 0));
+    EXPECT_EQ(0, r.process(10));
+
+    // The final deadline is dropped if it doesn't fit
+    c.res.reset();
+    io_uring_prep_nop(&c.add());
+    io_uring_prep_nop(&c.add(std::chrono::seconds(1)));
+    EXPECT_THROW(c.queue(), std::system_error);
+    runUntil(r, c);
+    EXPECT_THAT(*c.res, testing::ElementsAre(0, 0));
 }
 
 } // namespace stdplus
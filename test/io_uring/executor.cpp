@@ -0,0 +1,234 @@
+#include <sched.h>
+
+#include <stdplus/io_uring/executor.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+namespace stdplus
+{
+
+class Done
+{
+  public:
+    void set()
+    {
+        std::lock_guard lk(lock);
+        done = true;
+        cv.notify_all();
+    }
+
+    bool wait()
+    {
+        std::unique_lock lk(lock);
+        return cv.wait_for(lk, std::chrono::seconds(5), [&] { return done; });
+    }
+
+  private:
+    std::mutex lock;
+    std::condition_variable cv;
+    bool done = false;
+};
+
+class IoUringExecutorTest : public testing::Test
+{
+  protected:
+    static void SetUpTestCase()
+    {
+        io_uring r;
+        if (io_uring_queue_init(1, &r, 0) == -ENOSYS)
+        {
+            // Not supported, skip running this test
+            exit(77);
+        }
+        io_uring_queue_exit(&r);
+    }
+};
+
+TEST_F(IoUringExecutorTest, Empty)
+{
+    EXPECT_THROW(IoUringExecutor(0), std::system_error);
+    IoUringExecutor e(2);
+    EXPECT_EQ(2, e.size());
+    EXPECT_EQ(std::nullopt, e.currentShard());
+}
+
+TEST_F(IoUringExecutorTest, StartFailure)
+{
+    // DEFER_TASKRUN is rejected without SINGLE_ISSUER
+    EXPECT_THROW(IoUringExecutor(2, IoUring::Setup().set(
+                                        IoUring::SetupFlag::DeferTaskrun)),
+                 std::system_error);
+
+    // Only the second shard fails, the first may already be sleeping
+    cpu_set_t set;
+    ASSERT_EQ(0, sched_getaffinity(0, sizeof(set), &set));
+    std::optional<unsigned> good, bad;
+    for (unsigned i = 0; i < CPU_SETSIZE; ++i)
+    {
+        auto& cpu = CPU_ISSET(i, &set) ? good : bad;
+        if (!cpu)
+        {
+            cpu = i;
+        }
+    }
+    if (!good || !bad)
+    {
+        GTEST_SKIP();
+    }
+    std::array<unsigned, 2> cpus = {*good, *bad};
+    EXPECT_THROW(IoUringExecutor(2, IoUring::Setup(), cpus),
+                 std::system_error);
+}
+
+TEST_F(IoUringExecutorTest, Post)
+{
+    IoUringExecutor e(3);
+    std::array<std::optional<size_t>, 3> ran;
+    std::array<IoUring*, 3> rings = {};
+    std::array<Done, 3> done;
+    for (size_t i = 0; i < e.size(); ++i)
+    {
+        e.post(i, [&, i](IoUring& ring) {
+            ran[i] = e.currentShard();
+            rings[i] = &ring;
+            done[i].set();
+        });
+    }
+    for (size_t i = 0; i < e.size(); ++i)
+    {
+        ASSERT_TRUE(done[i].wait());
+        EXPECT_EQ(i, ran[i]);
+    }
+    EXPECT_NE(rings[0], rings[1]);
+    EXPECT_NE(rings[1], rings[2]);
+
+    Done fdDone;
+    std::optional<size_t> fdShard;
+    e.postFd(4, [&](IoUring&) {
+        fdShard = e.currentShard();
+        fdDone.set();
+    });
+    ASSERT_TRUE(fdDone.wait());
+    EXPECT_EQ(e.shardFor(4), fdShard);
+    EXPECT_THROW(e.shardFor(-1), std::system_error);
+    EXPECT_THROW(e.postFd(-1, [](IoUring&) {}), std::system_error);
+}
+
+TEST_F(IoUringExecutorTest, TaskThrows)
+{
+    IoUringExecutor e(1);
+    Done done;
+    e.post(0, [](IoUring&) { throw std::runtime_error("task"); });
+    e.post(0, [&](IoUring&) { done.set(); });
+    EXPECT_TRUE(done.wait());
+}
+
+TEST_F(IoUringExecutorTest, CrossShardIO)
+{
+    IoUringExecutor e(2);
+    struct Timeout : IoUring::CQEHandler
+    {
+        IoUringExecutor& e;
+        Done& done;
+        int32_t res = 0;
+        std::optional<size_t> completed;
+
+        Timeout(IoUringExecutor& e, Done& done) : e(e), done(done) {}
+
+        void handleCQE(io_uring_cqe& cqe) noexcept override
+        {
+            res = cqe.res;
+            // Hand the completion to the other shard
+            e.post(1, [this](IoUring&) {
+                completed = e.currentShard();
+                done.set();
+            });
+        }
+    };
+    Done done;
+    Timeout t(e, done);
+    auto kts = chronoToKTS(std::chrono::milliseconds(1));
+    e.post(0, [&](IoUring& ring) {
+        auto& sqe = ring.getSQE();
+        io_uring_prep_timeout(&sqe, &kts, 0, 0);
+        ring.setHandler(sqe, &t);
+    });
+    ASSERT_TRUE(done.wait());
+    EXPECT_EQ(-ETIME, t.res);
+    EXPECT_EQ(1, t.completed);
+}
+
+TEST_F(IoUringExecutorTest, Steal)
+{
+    IoUringExecutor e(4);
+    constexpr size_t tasks = 64;
+    std::mutex lock;
+    std::set<size_t> shards;
+    std::atomic<size_t> ran = 0;
+    Done done;
+    e.post(0, [&](IoUring&) {
+        for (size_t i = 0; i < tasks; ++i)
+        {
+            e.spawn([&](IoUring&) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                {
+                    std::lock_guard lk(lock);
+                    shards.insert(*e.currentShard());
+                }
+                if (++ran == tasks)
+                {
+                    done.set();
+                }
+            });
+        }
+    });
+    ASSERT_TRUE(done.wait());
+    EXPECT_GT(shards.size(), 1);
+}
+
+TEST_F(IoUringExecutorTest, SpawnBusy)
+{
+    IoUringExecutor e(2);
+    Done started, release;
+    e.post(0, [&](IoUring&) {
+        started.set();
+        release.wait();
+    });
+    ASSERT_TRUE(started.wait());
+
+    // The first spawn targets the busy shard, the idle one has to take it
+    Done done;
+    std::optional<size_t> shard;
+    e.spawn([&](IoUring&) {
+        shard = e.currentShard();
+        done.set();
+    });
+    EXPECT_TRUE(done.wait());
+    EXPECT_EQ(1, shard);
+    release.set();
+}
+
+TEST_F(IoUringExecutorTest, StopDrains)
+{
+    std::atomic<size_t> ran = 0;
+    {
+        IoUringExecutor e(2);
+        for (size_t i = 0; i < 100; ++i)
+        {
+            e.spawn([&](IoUring&) { ++ran; });
+        }
+        e.post(1, [&](IoUring&) { e.stop(); });
+    }
+    EXPECT_EQ(100, ran);
+}
+
+} // namespace stdplus